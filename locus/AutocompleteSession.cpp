@@ -0,0 +1,168 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::AutocompleteSession
+ */
+// ======================================================================
+
+#include "AutocompleteSession.h"
+#include <macgyver/Exception.h>
+#include <optional>
+
+namespace
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the prefix of a search word of form "prefix%"
+ *
+ * Nothing is returned for search words with other wildcards or escapes,
+ * they cannot be narrowed in memory.
+ */
+// ----------------------------------------------------------------------
+
+std::optional<std::string> search_prefix(const std::string& theSearchWord)
+{
+  if (theSearchWord.empty() || theSearchWord.back() != '%')
+    return std::nullopt;
+
+  auto prefix = theSearchWord.substr(0, theSearchWord.size() - 1);
+  if (prefix.find_first_of("%_\\") != std::string::npos)
+    return std::nullopt;
+
+  return prefix;
+}
+
+}  // namespace
+
+namespace Locus
+{
+const std::size_t AutocompleteSession::default_candidate_limit = 5000;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ */
+// ----------------------------------------------------------------------
+
+AutocompleteSession::AutocompleteSession(Query& theQuery, std::size_t theCandidateLimit)
+    : query(theQuery), candidate_limit(theCandidateLimit)
+{
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Forget the remembered candidates
+ */
+// ----------------------------------------------------------------------
+
+void AutocompleteSession::Reset()
+{
+  valid = false;
+  prefix.clear();
+  qualifiers.clear();
+  candidates.clear();
+  keys.clear();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Fetch locations by name, narrowing the previous candidates if possible
+ */
+// ----------------------------------------------------------------------
+
+Query::return_type AutocompleteSession::FetchByName(const QueryOptions& theOptions,
+                                                    const std::string& theName)
+{
+  try
+  {
+    query.SetOptions(theOptions);
+
+    const auto pos = theName.find(',');
+    const std::string searchword = theName.substr(0, pos);
+    const std::string name_qualifiers = (pos == std::string::npos ? "" : theName.substr(pos));
+
+    std::optional<std::string> key;
+    if (const auto word_prefix = search_prefix(searchword))
+      key = Query::NameSearchKey(theOptions, *word_prefix);
+
+    const bool narrow = (valid && key && theOptions.HashValue() == options_hash &&
+                         query.DataGeneration() == data_generation &&
+                         name_qualifiers == qualifiers &&
+                         key->compare(0, prefix.size(), prefix) == 0);
+
+    if (narrow)
+    {
+      // The previous candidates were complete, hence the new ones are among them
+
+      std::size_t n = 0;
+      for (std::size_t i = 0; i < candidates.size(); i++)
+      {
+        if (keys[i].compare(0, key->size(), *key) == 0)
+        {
+          if (n != i)
+          {
+            candidates[n] = std::move(candidates[i]);
+            keys[n] = std::move(keys[i]);
+          }
+          ++n;
+        }
+      }
+      candidates.resize(n);
+      keys.resize(n);
+
+      prefix = *key;
+      search.searchword = searchword;
+      ++narrowed_searches;
+    }
+    else
+    {
+      Reset();
+
+      const auto name_search = query.ParseNameSearch(theName);
+      if (!name_search)
+        return {};  // Unknown area
+
+      search = *name_search;
+      candidates = query.FetchNameCandidates(theOptions, search, true);
+      ++database_searches;
+
+      // Remember the candidates for the next search if they can be narrowed.
+      // With a full country search they may have been chosen by the fallback,
+      // and a longer prefix might find places in the listed countries again.
+
+      const bool fallback = (theOptions.GetFullCountrySearch() &&
+                             !theOptions.GetCountryCodes().empty() &&
+                             !theOptions.GetAllCountries());
+
+      if (key && !fallback && candidates.size() <= candidate_limit)
+      {
+        keys.reserve(candidates.size());
+        for (const auto& candidate : candidates)
+          keys.push_back(Query::NameSearchKey(theOptions, candidate.matched_name));
+
+        valid = true;
+        options_hash = theOptions.HashValue();
+        data_generation = query.DataGeneration();
+        qualifiers = name_qualifiers;
+        prefix = *key;
+      }
+    }
+
+    auto ret = query.FetchRankedLocations(theOptions, candidates, search);
+
+    if (!valid)
+      candidates.clear();
+
+    if (ret.empty() && theOptions.GetFuzzySearch())
+      ret = query.FetchBySimilarName(theOptions, search);
+
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,73 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::AutocompleteSession
+ *
+ * Name searches of a user typing a place name, such as "H%", "He%",
+ * "Hel%" and so on. The candidates of a prefix search are remembered,
+ * and when the next search only extends the prefix, they are narrowed
+ * in memory instead of searching the database again. Only the details
+ * of the best candidates are then fetched from the database.
+ *
+ * The candidates are remembered only if there are at most the given
+ * number of them. Searches with other wildcards, other options, other
+ * qualifiers or after a reload of in-memory data are always made in
+ * the database, as are full country searches.
+ *
+ * A session is not thread safe, and it uses the given Query for its
+ * database searches.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "Query.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Locus
+{
+class AutocompleteSession
+{
+ public:
+  static const std::size_t default_candidate_limit;
+
+  ~AutocompleteSession() = default;
+  AutocompleteSession() = delete;
+  AutocompleteSession(const AutocompleteSession& other) = delete;
+  AutocompleteSession& operator=(const AutocompleteSession& other) = delete;
+
+  explicit AutocompleteSession(Query& theQuery,
+                               std::size_t theCandidateLimit = default_candidate_limit);
+
+  // Same results as Query::FetchByName
+  Query::return_type FetchByName(const QueryOptions& theOptions, const std::string& theName);
+
+  // Forget the remembered candidates
+  void Reset();
+
+  // Number of searches made in the database and narrowed in memory
+  std::size_t DatabaseSearches() const { return database_searches; }
+  std::size_t NarrowedSearches() const { return narrowed_searches; }
+
+ private:
+  Query& query;
+  std::size_t candidate_limit;
+
+  // The remembered candidates and the search they were found with
+  bool valid = false;
+  std::size_t options_hash = 0;
+  std::size_t data_generation = 0;
+  std::string qualifiers;
+  std::string prefix;  // Search key of the prefix
+  Query::NameSearch search;
+  std::vector<Query::NameCandidate> candidates;
+  std::vector<std::string> keys;  // Search keys of the matched names
+
+  std::size_t database_searches = 0;
+  std::size_t narrowed_searches = 0;
+};  // class AutocompleteSession
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,387 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::BulkLoader
+ */
+// ======================================================================
+
+#include "BulkLoader.h"
+#include <macgyver/Exception.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <sys/resource.h>
+#include <thread>
+
+namespace
+{
+// Number of batches buffered per worker thread
+const std::size_t batches_per_thread = 2;
+
+// Rows of one batch, stored back to back
+struct Batch
+{
+  std::string data;
+  std::vector<std::size_t> ends;  // End position of each row in data
+  Locus::BulkLoader::RowHandler handler;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Bounded queue of batches shared by the loader and the workers
+ */
+// ----------------------------------------------------------------------
+
+class BatchQueue
+{
+ public:
+  explicit BatchQueue(std::size_t theCapacity) : capacity(theCapacity) {}
+
+  // Returns false if the load has been aborted
+  bool push(Batch&& theBatch)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this]() { return batches.size() < capacity || error; });
+    if (error)
+      return false;
+    batches.push_back(std::move(theBatch));
+    not_empty.notify_one();
+    return true;
+  }
+
+  // Returns false once there is nothing more to do
+  bool pop(Batch& theBatch)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this]() { return !batches.empty() || closed || error; });
+    if (error || batches.empty())
+      return false;
+    theBatch = std::move(batches.front());
+    batches.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+
+  // No more batches will be pushed
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    not_empty.notify_all();
+  }
+
+  // Abort the load, the first error is kept
+  void abort(std::exception_ptr theError)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error)
+      error = std::move(theError);
+    not_empty.notify_all();
+    not_full.notify_all();
+  }
+
+  std::exception_ptr failure()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+  }
+
+ private:
+  std::size_t capacity;
+  std::deque<Batch> batches;
+  bool closed = false;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Parse batches until the queue is closed or the load is aborted
+ */
+// ----------------------------------------------------------------------
+
+void parse_batches(BatchQueue& theQueue)
+{
+  try
+  {
+    Batch batch;
+    Locus::BulkLoader::Fields fields;
+    std::string buffer;
+
+    while (theQueue.pop(batch))
+    {
+      std::size_t start = 0;
+      for (const auto end : batch.ends)
+      {
+        Locus::BulkLoader::split(
+            std::string_view(batch.data).substr(start, end - start), fields, buffer);
+        batch.handler(fields);
+        start = end;
+      }
+    }
+  }
+  catch (...)
+  {
+    theQueue.abort(std::current_exception());
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Peak resident set size of the process in kilobytes
+ */
+// ----------------------------------------------------------------------
+
+std::size_t peak_rss_kb()
+{
+  struct rusage usage = {};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Value of an octal or hexadecimal digit, or -1
+ */
+// ----------------------------------------------------------------------
+
+int digit_value(char theChar, int theBase)
+{
+  int value = -1;
+  if (theChar >= '0' && theChar <= '9')
+    value = theChar - '0';
+  else if (theChar >= 'a' && theChar <= 'f')
+    value = theChar - 'a' + 10;
+  else if (theChar >= 'A' && theChar <= 'F')
+    value = theChar - 'A' + 10;
+  return (value < theBase ? value : -1);
+}
+
+}  // namespace
+
+namespace Locus
+{
+const std::size_t BulkLoader::default_batch_size = 8192;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ */
+// ----------------------------------------------------------------------
+
+BulkLoader::BulkLoader(pqxx::connection& theConnection,
+                       unsigned int theThreads,
+                       std::size_t theBatchSize)
+    : conn(theConnection),
+      threads(theThreads > 0 ? theThreads : std::max(1U, std::thread::hardware_concurrency())),
+      batch_size(std::max<std::size_t>(1, theBatchSize))
+{
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Split a line of COPY text format into fields
+ *
+ * Fields are separated by tabs, \N is a NULL value, and backslash
+ * escapes are used for special characters. Fields without escapes
+ * refer to the line itself.
+ */
+// ----------------------------------------------------------------------
+
+void BulkLoader::split(std::string_view theLine, Fields& theFields, std::string& theBuffer)
+{
+  try
+  {
+    if (!theLine.empty() && theLine.back() == '\n')
+      theLine.remove_suffix(1);
+
+    theFields.clear();
+    theBuffer.clear();
+    theBuffer.reserve(theLine.size());  // Unescaped values are never longer
+
+    std::size_t start = 0;
+    while (true)
+    {
+      auto end = theLine.find('\t', start);
+      if (end == std::string_view::npos)
+        end = theLine.size();
+
+      const auto field = theLine.substr(start, end - start);
+
+      if (field == "\\N")
+        theFields.emplace_back(std::nullopt);
+      else if (field.find('\\') == std::string_view::npos)
+        theFields.emplace_back(field);
+      else
+      {
+        const auto pos = theBuffer.size();
+        for (std::size_t i = 0; i < field.size(); i++)
+        {
+          char c = field[i];
+          if (c == '\\' && i + 1 < field.size())
+          {
+            c = field[++i];
+            switch (c)
+            {
+              case 'b':
+                c = '\b';
+                break;
+              case 'f':
+                c = '\f';
+                break;
+              case 'n':
+                c = '\n';
+                break;
+              case 'r':
+                c = '\r';
+                break;
+              case 't':
+                c = '\t';
+                break;
+              case 'v':
+                c = '\v';
+                break;
+              case 'x':
+              {
+                int value = 0;
+                int n = 0;
+                for (; n < 2 && i + 1 < field.size(); n++)
+                {
+                  const int digit = digit_value(field[i + 1], 16);
+                  if (digit < 0)
+                    break;
+                  value = 16 * value + digit;
+                  ++i;
+                }
+                if (n > 0)
+                  c = static_cast<char>(value);
+                break;
+              }
+              default:
+              {
+                if (digit_value(c, 8) >= 0)
+                {
+                  int value = digit_value(c, 8);
+                  for (int n = 1; n < 3 && i + 1 < field.size(); n++)
+                  {
+                    const int digit = digit_value(field[i + 1], 8);
+                    if (digit < 0)
+                      break;
+                    value = 8 * value + digit;
+                    ++i;
+                  }
+                  c = static_cast<char>(value);
+                }
+                break;
+              }
+            }
+          }
+          theBuffer += c;
+        }
+        theFields.emplace_back(std::string_view(theBuffer).substr(pos));
+      }
+
+      if (end == theLine.size())
+        break;
+      start = end + 1;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Stream the query result and parse it in worker threads
+ */
+// ----------------------------------------------------------------------
+
+const BulkLoader::Statistics& BulkLoader::load(const std::string& theQuery,
+                                               const BatchHandler& theBatchHandler)
+{
+  try
+  {
+    const auto start_time = std::chrono::steady_clock::now();
+    stats = Statistics();
+
+    BatchQueue queue(batches_per_thread * threads);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+      workers.emplace_back([&queue]() { parse_batches(queue); });
+
+    try
+    {
+      pqxx::read_transaction tx(conn);
+      auto stream = pqxx::stream_from::query(tx, theQuery);
+
+      Batch batch;
+      bool aborted = false;
+      while (!aborted)
+      {
+        auto line = stream.get_raw_line();
+        if (!line.first)
+          break;
+
+        batch.data.append(line.first.get(), line.second);
+        batch.ends.push_back(batch.data.size());
+        ++stats.rows;
+        stats.bytes += line.second;
+
+        if (batch.ends.size() >= batch_size)
+        {
+          batch.handler = theBatchHandler();
+          aborted = !queue.push(std::move(batch));
+          ++stats.batches;
+          batch = Batch();
+        }
+      }
+
+      if (!aborted && !batch.ends.empty())
+      {
+        batch.handler = theBatchHandler();
+        queue.push(std::move(batch));
+        ++stats.batches;
+      }
+
+      // If a worker failed, the rest of the result is read away so that the
+      // connection leaves the COPY state and remains usable. Cancelling the
+      // query instead could cancel a later query if the COPY finished first.
+
+      if (aborted)
+        while (stream.get_raw_line().first)
+          ;
+      stream.complete();
+    }
+    catch (...)
+    {
+      queue.abort(std::current_exception());
+    }
+
+    queue.close();
+    for (auto& worker : workers)
+      worker.join();
+
+    if (auto error = queue.failure())
+      std::rethrow_exception(error);
+
+    stats.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    stats.peak_rss_kb = peak_rss_kb();
+    return stats;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Bulk load failed").addParameter("Query", theQuery);
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
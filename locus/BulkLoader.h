@@ -0,0 +1,126 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::BulkLoader
+ *
+ * Streams the result of a query with COPY ... TO STDOUT and parses the
+ * rows in worker threads, so that large tables can be read into
+ * in-memory data structures without materializing a pqxx::result.
+ *
+ * The rows are split into batches. Each batch is parsed by a single
+ * worker in result order into its own output object, typically a set
+ * of column arrays, and the batches are returned in result order. At
+ * most a few batches per worker are buffered, hence the transient
+ * memory use does not depend on the size of the table.
+ *
+ * The load runs in its own read transaction, hence the connection must
+ * not have an open transaction during load(). If a parser throws, the
+ * rest of the result is still read before the error is passed on, so
+ * that the connection remains usable. If the streaming itself fails,
+ * for example because the connection breaks, the connection may be left
+ * unusable and should be reopened.
+ *
+ * \code
+ * struct Columns { std::vector<int> ids; std::vector<std::string> names; };
+ *
+ * pqxx::connection conn(...);
+ * Locus::BulkLoader loader(conn);
+ * auto batches = loader.load<Columns>(
+ *     "SELECT id, name FROM geonames",
+ *     [](Columns& theColumns, const Locus::BulkLoader::Fields& theFields)
+ *     {
+ *       theColumns.ids.push_back(std::stoi(std::string(*theFields[0])));
+ *       theColumns.names.emplace_back(theFields[1].value_or(""));
+ *     });
+ * std::cout << loader.statistics().rows_per_second() << " rows/s\n";
+ * \endcode
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Locus
+{
+class BulkLoader
+{
+ public:
+  // Fields of one row, NULL values are empty optionals
+  using Fields = std::vector<std::optional<std::string_view>>;
+
+  // Parser for the rows of one batch, called in a worker thread
+  using RowHandler = std::function<void(const Fields& theFields)>;
+
+  // Returns the parser for the next batch, called in the thread calling load()
+  using BatchHandler = std::function<RowHandler()>;
+
+  struct Statistics
+  {
+    std::size_t rows = 0;
+    std::size_t batches = 0;
+    std::size_t bytes = 0;         // Size of the streamed data
+    double seconds = 0;            // Wall clock time of the load
+    std::size_t peak_rss_kb = 0;   // Peak resident set size of the process after the load
+
+    double rows_per_second() const { return (seconds > 0 ? rows / seconds : 0); }
+  };
+
+  static const std::size_t default_batch_size;
+
+  ~BulkLoader() = default;
+  BulkLoader() = delete;
+  BulkLoader(const BulkLoader& other) = delete;
+  BulkLoader& operator=(const BulkLoader& other) = delete;
+
+  // Zero threads means one per hardware thread
+  explicit BulkLoader(pqxx::connection& theConnection,
+                      unsigned int theThreads = 0,
+                      std::size_t theBatchSize = default_batch_size);
+
+  // Stream the query result, the handlers are called for each batch and row
+  const Statistics& load(const std::string& theQuery, const BatchHandler& theBatchHandler);
+
+  // Stream the query result into output objects, one per batch, in result order
+  template <typename Columns>
+  std::vector<Columns> load(const std::string& theQuery,
+                            const std::function<void(Columns&, const Fields&)>& theParser)
+  {
+    // Existing batches stay in place while workers fill them and new ones are added
+    std::list<Columns> batches;
+    load(theQuery,
+         [&]() -> RowHandler
+         {
+           auto& columns = batches.emplace_back();
+           return [&columns, &theParser](const Fields& theFields)
+           { theParser(columns, theFields); };
+         });
+    return std::vector<Columns>(std::make_move_iterator(batches.begin()),
+                                std::make_move_iterator(batches.end()));
+  }
+
+  // Statistics of the latest load
+  const Statistics& statistics() const { return stats; }
+
+  // Split a line of COPY text format into unescaped fields. Unescaped
+  // values are stored in the buffer, which must not change while the
+  // fields are in use.
+  static void split(std::string_view theLine, Fields& theFields, std::string& theBuffer);
+
+ private:
+  pqxx::connection& conn;
+  unsigned int threads;
+  std::size_t batch_size;
+  Statistics stats;
+};  // class BulkLoader
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,185 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::ChangeListener
+ */
+// ======================================================================
+
+#include "ChangeListener.h"
+#include <macgyver/Exception.h>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+// Seconds to wait for notifications before checking whether to stop
+const long poll_interval = 1;
+
+// Seconds to wait before reconnecting after a connection failure
+const int reconnect_delay = 5;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Quote a value for a libpq connection string
+ */
+// ----------------------------------------------------------------------
+
+std::string conninfo_value(const std::string& theValue)
+{
+  std::string ret = "'";
+  for (char c : theValue)
+  {
+    if (c == '\'' || c == '\\')
+      ret += '\\';
+    ret += c;
+  }
+  ret += '\'';
+  return ret;
+}
+
+}  // namespace
+
+namespace Locus
+{
+const char* ChangeListener::default_channel = "fminames_changes";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Receives the notifications on the listener connection
+ */
+// ----------------------------------------------------------------------
+
+class ChangeListener::Receiver : public pqxx::notification_receiver
+{
+ public:
+  Receiver(pqxx::connection& theConn, const std::string& theChannel, ChangeListener& theListener)
+      : pqxx::notification_receiver(theConn, theChannel), listener(theListener)
+  {
+  }
+
+  void operator()(const std::string& thePayload, int /* theBackendPid */) override
+  {
+    listener.dispatch(ChangeListener::parse(thePayload));
+  }
+
+ private:
+  ChangeListener& listener;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Connect and start listening
+ *
+ * The LISTEN is active once the constructor returns, hence no
+ * notification sent after that is missed.
+ */
+// ----------------------------------------------------------------------
+
+ChangeListener::ChangeListener(const std::string& theHost,
+                               const std::string& theUser,
+                               const std::string& thePass,
+                               const std::string& theDatabase,
+                               const std::string& thePort,
+                               const std::string& theChannel)
+    : channel(theChannel)
+{
+  try
+  {
+    conninfo = "host=" + conninfo_value(theHost) + " port=" + conninfo_value(thePort) +
+               " dbname=" + conninfo_value(theDatabase) + " user=" + conninfo_value(theUser) +
+               " password=" + conninfo_value(thePass);
+    connect();
+    listener_thread = std::thread([this]() { run(); });
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to listen to change notifications")
+        .addParameter("Channel", theChannel);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Stop listening
+ */
+// ----------------------------------------------------------------------
+
+ChangeListener::~ChangeListener()
+{
+  stopping = true;
+  if (listener_thread.joinable())
+    listener_thread.join();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Parse a notification payload of form "table" or "table:key"
+ */
+// ----------------------------------------------------------------------
+
+ChangeListener::Change ChangeListener::parse(const std::string& thePayload)
+{
+  Change change;
+  const auto pos = thePayload.find(':');
+  if (pos == std::string::npos)
+    change.table = thePayload;
+  else
+  {
+    change.table = thePayload.substr(0, pos);
+    change.key = thePayload.substr(pos + 1);
+  }
+
+  // Tolerate schema qualified table names
+  const auto dot = change.table.rfind('.');
+  if (dot != std::string::npos)
+    change.table.erase(0, dot + 1);
+
+  if (change.table.empty())
+    change.table = "*";
+
+  return change;
+}
+
+void ChangeListener::connect()
+{
+  receiver.reset();
+  conn = std::make_unique<pqxx::connection>(conninfo);
+  receiver = std::make_unique<Receiver>(*conn, channel, *this);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief The listener thread
+ */
+// ----------------------------------------------------------------------
+
+void ChangeListener::run()
+{
+  while (!stopping)
+  {
+    try
+    {
+      if (!conn)
+      {
+        connect();
+        // Anything may have changed while we were not listening
+        dispatch(Change{"*", ""});
+      }
+      conn->await_notification(poll_interval, 0);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << "Locus::ChangeListener: " << e.what() << '\n';
+      receiver.reset();
+      conn.reset();
+      for (int i = 0; i < reconnect_delay && !stopping; i++)
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }
+
+  receiver.reset();
+  conn.reset();
+}
+
+}  // namespace Locus
+
+// ======================================================================
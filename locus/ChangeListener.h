@@ -0,0 +1,83 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::ChangeListener
+ *
+ * Listens to a PostgreSQL notification channel on a dedicated
+ * connection and passes the changes to subscribers, which may then
+ * invalidate or refresh whatever they have cached.
+ *
+ * The payload of a notification is "table" or "table:key", where the
+ * key is the geonames id, keyword or other identifier of the modified
+ * row. An empty key means the whole table may have changed. For example
+ *
+ * \code
+ * CREATE FUNCTION notify_fminames_change() RETURNS trigger AS $$
+ * BEGIN
+ *   PERFORM pg_notify('fminames_changes',
+ *                     TG_TABLE_NAME || ':' || COALESCE(NEW.geonames_id, OLD.geonames_id));
+ *   RETURN NULL;
+ * END $$ LANGUAGE plpgsql;
+ *
+ * CREATE TRIGGER alternate_geonames_changed AFTER INSERT OR UPDATE OR DELETE
+ *   ON alternate_geonames FOR EACH ROW EXECUTE PROCEDURE notify_fminames_change();
+ * \endcode
+ *
+ * If the connection is lost, notifications sent meanwhile are lost
+ * too. Subscribers are then told that everything may have changed
+ * (table "*") once the connection has been reestablished.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "ChangeSource.h"
+#include <atomic>
+#include <memory>
+#include <pqxx/pqxx>
+#include <string>
+#include <thread>
+
+namespace Locus
+{
+class ChangeListener : public ChangeSource
+{
+ public:
+  static const char* default_channel;
+
+  ~ChangeListener() override;
+  ChangeListener() = delete;
+  ChangeListener(const ChangeListener& other) = delete;
+  ChangeListener& operator=(const ChangeListener& other) = delete;
+  ChangeListener(ChangeListener&& other) = delete;
+  ChangeListener& operator=(ChangeListener&& other) = delete;
+
+  ChangeListener(const std::string& theHost,
+                 const std::string& theUser,
+                 const std::string& thePass,
+                 const std::string& theDatabase,
+                 const std::string& thePort,
+                 const std::string& theChannel = default_channel);
+
+  // Note: callbacks are run in the listener thread
+
+  static Change parse(const std::string& thePayload);
+
+ private:
+  class Receiver;
+
+  void connect();
+  void run();
+
+  std::string conninfo;
+  std::string channel;
+
+  std::unique_ptr<pqxx::connection> conn;
+  std::unique_ptr<Receiver> receiver;
+
+  std::atomic<bool> stopping{false};
+  std::thread listener_thread;
+};  // class ChangeListener
+
+}  // namespace Locus
+
+// ======================================================================
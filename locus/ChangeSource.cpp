@@ -0,0 +1,67 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::ChangeSource
+ */
+// ======================================================================
+
+#include "ChangeSource.h"
+#include <iostream>
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Add a callback for changes
+ */
+// ----------------------------------------------------------------------
+
+void ChangeSource::subscribe(const Callback& theCallback)
+{
+  std::lock_guard<std::mutex> lock(subscriber_mutex);
+  subscribers.push_back(theCallback);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Pass a change to all subscribers
+ *
+ * A failing subscriber does not prevent the others from seeing the change.
+ *
+ * \return False if any subscriber failed
+ */
+// ----------------------------------------------------------------------
+
+bool ChangeSource::dispatch(const Change& theChange)
+{
+  std::vector<Callback> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(subscriber_mutex);
+    callbacks = subscribers;
+  }
+
+  bool ok = true;
+  for (const auto& callback : callbacks)
+  {
+    try
+    {
+      callback(theChange);
+    }
+    catch (const std::exception& e)
+    {
+      ok = false;
+      std::cerr << "Locus::ChangeSource: change handler for " << theChange.table
+                << " failed: " << e.what() << '\n';
+    }
+    catch (...)
+    {
+      ok = false;
+      std::cerr << "Locus::ChangeSource: change handler for " << theChange.table
+                << " failed\n";
+    }
+  }
+  return ok;
+}
+
+}  // namespace Locus
+
+// ======================================================================
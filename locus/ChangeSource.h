@@ -0,0 +1,51 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::ChangeSource
+ *
+ * Common base for objects which report modifications in the fminames
+ * tables to subscribers which cache data derived from them.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Locus
+{
+class ChangeSource
+{
+ public:
+  struct Change
+  {
+    std::string table;  // "*" if everything may have changed
+    std::string key;    // empty if the whole table may have changed
+  };
+
+  using Callback = std::function<void(const Change&)>;
+
+  virtual ~ChangeSource() = default;
+  ChangeSource() = default;
+  ChangeSource(const ChangeSource& other) = delete;
+  ChangeSource& operator=(const ChangeSource& other) = delete;
+  ChangeSource(ChangeSource&& other) = delete;
+  ChangeSource& operator=(ChangeSource&& other) = delete;
+
+  // Callbacks must not block for long
+  void subscribe(const Callback& theCallback);
+
+ protected:
+  // Returns false if any subscriber failed
+  bool dispatch(const Change& theChange);
+
+ private:
+  std::mutex subscriber_mutex;
+  std::vector<Callback> subscribers;
+};  // class ChangeSource
+
+}  // namespace Locus
+
+// ======================================================================
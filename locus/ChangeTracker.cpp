@@ -0,0 +1,170 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::ChangeTracker
+ */
+// ======================================================================
+
+#include "ChangeTracker.h"
+#include <fmt/format.h>
+#include <macgyver/Exception.h>
+#include <algorithm>
+
+namespace
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Identifiers are inserted into the SQL as is, hence validate them
+ */
+// ----------------------------------------------------------------------
+
+void check_identifier(const std::string& theName)
+{
+  const auto valid = [](char c)
+  { return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_'; };
+
+  if (theName.empty() || !std::all_of(theName.begin(), theName.end(), valid))
+    throw Fmi::Exception(BCP, "Invalid name for change tracking: '" + theName + "'");
+}
+
+}  // namespace
+
+namespace Locus
+{
+const char* ChangeTracker::default_column = "last_modified";
+
+const std::size_t ChangeTracker::max_keys = 10000;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Track the tables from which the location data is built
+ */
+// ----------------------------------------------------------------------
+
+ChangeTracker::ChangeTracker(const std::string& theColumn)
+    : ChangeTracker(theColumn,
+                    {{"geonames", "id"},
+                     {"alternate_geonames", "geonames_id"},
+                     {"keywords_has_geonames", "keyword"}})
+{
+}
+
+ChangeTracker::ChangeTracker(const std::string& theColumn, std::vector<Source> theSources)
+    : column(theColumn), sources(std::move(theSources))
+{
+  try
+  {
+    check_identifier(column);
+    for (const auto& source : sources)
+    {
+      check_identifier(source.table);
+      check_identifier(source.key_column);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Report rows modified since the previous poll
+ *
+ * The new watermark is established first and the modified rows are then
+ * fetched up to it, so rows modified during the poll are reported by the
+ * next one.
+ *
+ * The watermark of a table is advanced only after its changes have been
+ * fetched and accepted by all subscribers. If anything fails, the same
+ * range is reported again by the next poll, hence subscribers must
+ * tolerate changes being reported more than once.
+ *
+ * \return The number of changes reported
+ */
+// ----------------------------------------------------------------------
+
+std::size_t ChangeTracker::poll(Fmi::Database::PostgreSQLConnection& theConn)
+{
+  try
+  {
+    constexpr const char* sql1 = "SELECT max({0})::text FROM {1}";
+    constexpr const char* sql2 =
+        "SELECT DISTINCT {2}::text FROM {1} WHERE {0}>{3} AND {0}<={4} AND {2} IS NOT NULL"
+        " LIMIT {5}";
+
+    std::lock_guard<std::mutex> lock(poll_mutex);
+
+    std::size_t count = 0;
+    for (const auto& source : sources)
+    {
+      pqxx::result res = theConn.executeNonTransaction(fmt::format(sql1, column, source.table));
+
+      std::optional<std::string> watermark;
+      if (!res.empty() && !res[0][0].is_null())
+        watermark = res[0][0].as<std::string>();
+
+      auto pos = watermarks.find(source.table);
+      if (pos == watermarks.end())
+      {
+        // First poll: the data has just been loaded
+        watermarks[source.table] = watermark;
+        continue;
+      }
+
+      const std::optional<std::string> previous = pos->second;
+
+      if (!watermark || watermark == previous)
+      {
+        pos->second = watermark;
+        continue;
+      }
+
+      bool accepted = true;
+
+      if (!previous)
+      {
+        // The table was empty before
+        accepted = dispatch(Change{source.table, ""});
+        ++count;
+      }
+      else
+      {
+        // One extra row tells whether there are too many to report individually
+        res = theConn.executeNonTransaction(fmt::format(sql2,
+                                                        column,
+                                                        source.table,
+                                                        source.key_column,
+                                                        theConn.quote(*previous),
+                                                        theConn.quote(*watermark),
+                                                        max_keys + 1));
+
+        if (static_cast<std::size_t>(res.size()) > max_keys)
+        {
+          accepted = dispatch(Change{source.table, ""});
+          ++count;
+        }
+        else
+        {
+          for (const auto& row : res)
+          {
+            accepted &= dispatch(Change{source.table, row[0].as<std::string>()});
+            ++count;
+          }
+        }
+      }
+
+      if (accepted)
+        pos->second = watermark;
+    }
+
+    return count;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to poll for modified rows");
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
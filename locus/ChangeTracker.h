@@ -0,0 +1,58 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::ChangeTracker
+ *
+ * Finds rows modified since the previous poll using a modification
+ * timestamp or sequence column and reports them to subscribers, so that
+ * in-memory data can be patched instead of being reloaded completely.
+ *
+ * Deleted rows cannot be detected this way; use a ChangeListener or a
+ * full reload for them. Rows committed out of order with respect to the
+ * tracked column may also be missed, hence a sequence assigned at commit
+ * time is preferable to a timestamp assigned at insert time.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "ChangeSource.h"
+#include <macgyver/PostgreSQLConnection.h>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Locus
+{
+class ChangeTracker : public ChangeSource
+{
+ public:
+  struct Source
+  {
+    std::string table;       // table to track
+    std::string key_column;  // reported as the key of the change
+  };
+
+  static const char* default_column;
+
+  // More modified rows than this are reported as a change of the whole table
+  static const std::size_t max_keys;
+
+  explicit ChangeTracker(const std::string& theColumn = default_column);
+  ChangeTracker(const std::string& theColumn, std::vector<Source> theSources);
+
+  // Report changes since the previous poll. The first poll only records the current state.
+  std::size_t poll(Fmi::Database::PostgreSQLConnection& theConn);
+
+ private:
+  std::string column;
+  std::vector<Source> sources;
+  std::map<std::string, std::optional<std::string>> watermarks;  // Latest seen value per table
+  std::mutex poll_mutex;
+};  // class ChangeTracker
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,106 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::FlatMap
+ *
+ * A map stored as a sorted vector of key-value pairs. Elements are
+ * first added in any order, after which sort() orders them and removes
+ * duplicate keys. Lookups are then binary searches over contiguous
+ * memory, which is faster than following the nodes of a std::map when
+ * the map is built once and searched once per result row.
+ *
+ * The elements are allocated from the given memory resource.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace Locus
+{
+template <typename Key, typename Value, typename Compare = std::less<>>
+class FlatMap
+{
+ public:
+  using value_type = std::pair<Key, Value>;
+  using container_type = std::pmr::vector<value_type>;
+  using const_iterator = typename container_type::const_iterator;
+
+  // Which element to keep when the same key has been added several times
+  enum class Duplicates
+  {
+    KeepFirst,
+    KeepLast
+  };
+
+  explicit FlatMap(std::pmr::memory_resource* theResource = std::pmr::get_default_resource())
+      : items(theResource)
+  {
+  }
+
+  void reserve(std::size_t theSize) { items.reserve(theSize); }
+
+  // Add an element. The element can be found only after sort() has been called.
+  template <typename K, typename V>
+  void add(K&& theKey, V&& theValue)
+  {
+    items.emplace_back(std::forward<K>(theKey), std::forward<V>(theValue));
+  }
+
+  // Order the elements by key and remove duplicate keys
+  void sort(Duplicates theDuplicates = Duplicates::KeepFirst)
+  {
+    // Reversing first makes the last added duplicate the first one after a stable sort
+    if (theDuplicates == Duplicates::KeepLast)
+      std::reverse(items.begin(), items.end());
+
+    std::stable_sort(items.begin(),
+                     items.end(),
+                     [this](const value_type& a, const value_type& b)
+                     { return compare(a.first, b.first); });
+
+    auto last = std::unique(items.begin(),
+                            items.end(),
+                            [this](const value_type& a, const value_type& b)
+                            { return !compare(a.first, b.first) && !compare(b.first, a.first); });
+    items.erase(last, items.end());
+  }
+
+  // Binary search, returns end() if the key is not found
+  template <typename K>
+  const_iterator find(const K& theKey) const
+  {
+    auto pos = std::lower_bound(items.begin(),
+                                items.end(),
+                                theKey,
+                                [this](const value_type& item, const K& key)
+                                { return compare(item.first, key); });
+    if (pos != items.end() && !compare(theKey, pos->first))
+      return pos;
+    return items.end();
+  }
+
+  template <typename K>
+  bool contains(const K& theKey) const
+  {
+    return find(theKey) != items.end();
+  }
+
+  const_iterator begin() const { return items.begin(); }
+  const_iterator end() const { return items.end(); }
+  std::size_t size() const { return items.size(); }
+  bool empty() const { return items.empty(); }
+
+ private:
+  container_type items;
+  Compare compare;
+};  // class FlatMap
+
+}  // namespace Locus
+
+// ======================================================================
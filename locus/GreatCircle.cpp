@@ -0,0 +1,280 @@
+// ======================================================================
+/*!
+ * \brief Implementation of great circle distances
+ */
+// ======================================================================
+
+#include "GreatCircle.h"
+#include <macgyver/Exception.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOCUS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+const double deg = M_PI / 180;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Haversine distance with precomputed values for the first point
+ */
+// ----------------------------------------------------------------------
+
+double haversine(double theLongitude,
+                 double theLatitude,
+                 double theCosLatitude,
+                 double theLongitude2,
+                 double theLatitude2)
+{
+  const double s1 = std::sin(0.5 * deg * (theLatitude2 - theLatitude));
+  const double s2 = std::sin(0.5 * deg * (theLongitude2 - theLongitude));
+  const double a = s1 * s1 + theCosLatitude * std::cos(deg * theLatitude2) * s2 * s2;
+  return 2 * Locus::earth_radius * std::asin(std::sqrt(std::min(1.0, a)));
+}
+
+void distances_scalar(float theLongitude,
+                      float theLatitude,
+                      const float* theLongitudes,
+                      const float* theLatitudes,
+                      std::size_t theCount,
+                      float* theDistances)
+{
+  const double coslat = std::cos(deg * theLatitude);
+  for (std::size_t i = 0; i < theCount; i++)
+    theDistances[i] = static_cast<float>(
+        haversine(theLongitude, theLatitude, coslat, theLongitudes[i], theLatitudes[i]));
+}
+
+#ifdef LOCUS_X86
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Sine of eight angles in the range [-pi/2,pi/2]
+ *
+ * Taylor series up to x^11, the truncation error is below 6e-8.
+ */
+// ----------------------------------------------------------------------
+
+__attribute__((target("avx2,fma"))) __m256 sin_avx2(__m256 x)
+{
+  const __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_set1_ps(-1.0f / 39916800);
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f / 362880));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-1.0f / 5040));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f / 120));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-1.0f / 6));
+  return _mm256_fmadd_ps(_mm256_mul_ps(p, x2), x, x);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Arcsine of eight values in the range [0,1]
+ *
+ * The Cephes single precision approximation: a polynomial for values
+ * up to 0.5, and asin(x) = pi/2 - 2 asin(sqrt((1-x)/2)) above it.
+ */
+// ----------------------------------------------------------------------
+
+__attribute__((target("avx2,fma"))) __m256 asin_avx2(__m256 x)
+{
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 large = _mm256_cmp_ps(x, half, _CMP_GT_OQ);
+
+  const __m256 z_large = _mm256_mul_ps(half, _mm256_sub_ps(_mm256_set1_ps(1.0f), x));
+  const __m256 z = _mm256_blendv_ps(_mm256_mul_ps(x, x), z_large, large);
+  const __m256 t = _mm256_blendv_ps(x, _mm256_sqrt_ps(z_large), large);
+
+  __m256 p = _mm256_set1_ps(4.2163199048E-2f);
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.4181311049E-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(4.5470025998E-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(7.4953002686E-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.6666752422E-1f));
+  const __m256 y = _mm256_fmadd_ps(_mm256_mul_ps(p, z), t, t);
+
+  const __m256 y_large =
+      _mm256_fnmadd_ps(_mm256_set1_ps(2.0f), y, _mm256_set1_ps(static_cast<float>(M_PI / 2)));
+  return _mm256_blendv_ps(y, y_large, large);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Haversine distances of eight points
+ *
+ * All sine arguments are reduced to [-pi/2,pi/2]: the half latitude
+ * difference and mean are there already, sin^2 of the half longitude
+ * difference is symmetric around pi/2, and cos(x) = sin(pi/2 - |x|).
+ *
+ * Near antipodal points the haversine a is close to one and asin(sqrt(a))
+ * loses most of its single precision accuracy. The complement 1-a is
+ * then calculated directly as the haversine to the antipode of the
+ * second point, and the distance is half a circumference minus that.
+ */
+// ----------------------------------------------------------------------
+
+__attribute__((target("avx2,fma"))) __m256 haversine_avx2(__m256 theLongitude,
+                                                         __m256 theLatitude,
+                                                         __m256 theCosLatitude,
+                                                         __m256 theLongitudes,
+                                                         __m256 theLatitudes)
+{
+  const __m256 half_deg = _mm256_set1_ps(static_cast<float>(deg / 2));
+  const __m256 full_deg = _mm256_set1_ps(static_cast<float>(deg));
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 pi = _mm256_set1_ps(static_cast<float>(M_PI));
+  const __m256 half_pi = _mm256_set1_ps(static_cast<float>(M_PI / 2));
+
+  // sin((lat2-lat1)/2) and sin((lat1+lat2)/2)
+  const __m256 s1 = sin_avx2(_mm256_mul_ps(_mm256_sub_ps(theLatitudes, theLatitude), half_deg));
+  const __m256 s3 = sin_avx2(_mm256_mul_ps(_mm256_add_ps(theLatitudes, theLatitude), half_deg));
+
+  // sin((lon2-lon1)/2) and cos((lon2-lon1)/2) up to sign
+  const __m256 h2 = _mm256_andnot_ps(
+      sign, _mm256_mul_ps(_mm256_sub_ps(theLongitudes, theLongitude), half_deg));
+  const __m256 s2 = sin_avx2(_mm256_min_ps(h2, _mm256_sub_ps(pi, h2)));
+  const __m256 c2 = sin_avx2(_mm256_sub_ps(half_pi, h2));
+
+  // cos(lat1) * cos(lat2)
+  const __m256 lat = _mm256_andnot_ps(sign, _mm256_mul_ps(theLatitudes, full_deg));
+  const __m256 coslat = _mm256_mul_ps(theCosLatitude, sin_avx2(_mm256_sub_ps(half_pi, lat)));
+
+  const __m256 a = _mm256_fmadd_ps(s1, s1, _mm256_mul_ps(coslat, _mm256_mul_ps(s2, s2)));
+  const __m256 b = _mm256_fmadd_ps(s3, s3, _mm256_mul_ps(coslat, _mm256_mul_ps(c2, c2)));
+
+  const __m256 near = _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+  const __m256 x = _mm256_max_ps(_mm256_min_ps(a, b), _mm256_setzero_ps());
+  const __m256 half_angle = asin_avx2(_mm256_sqrt_ps(x));
+  const __m256 angle = _mm256_add_ps(half_angle, half_angle);
+  const __m256 distance = _mm256_blendv_ps(_mm256_sub_ps(pi, angle), angle, near);
+
+  return _mm256_mul_ps(_mm256_set1_ps(static_cast<float>(Locus::earth_radius)), distance);
+}
+
+__attribute__((target("avx2,fma"))) void distances_avx2(float theLongitude,
+                                                       float theLatitude,
+                                                       const float* theLongitudes,
+                                                       const float* theLatitudes,
+                                                       std::size_t theCount,
+                                                       float* theDistances)
+{
+  const __m256 lon = _mm256_set1_ps(theLongitude);
+  const __m256 lat = _mm256_set1_ps(theLatitude);
+  const __m256 coslat = _mm256_set1_ps(static_cast<float>(std::cos(deg * theLatitude)));
+
+  std::size_t i = 0;
+  for (; i + 8 <= theCount; i += 8)
+  {
+    const __m256 d = haversine_avx2(
+        lon, lat, coslat, _mm256_loadu_ps(theLongitudes + i), _mm256_loadu_ps(theLatitudes + i));
+    _mm256_storeu_ps(theDistances + i, d);
+  }
+
+  // The remaining points are padded so that every point gets the same treatment
+  if (i < theCount)
+  {
+    alignas(32) float lons[8] = {};
+    alignas(32) float lats[8] = {};
+    alignas(32) float d[8];
+    const std::size_t n = theCount - i;
+    std::copy(theLongitudes + i, theLongitudes + theCount, lons);
+    std::copy(theLatitudes + i, theLatitudes + theCount, lats);
+    _mm256_store_ps(
+        d, haversine_avx2(lon, lat, coslat, _mm256_load_ps(lons), _mm256_load_ps(lats)));
+    std::copy(d, d + n, theDistances + i);
+  }
+}
+
+#endif
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Whether the processor supports the AVX2 kernel
+ */
+// ----------------------------------------------------------------------
+
+bool avx2_supported()
+{
+#ifdef LOCUS_X86
+  static const bool supported = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+  return supported;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+namespace Locus
+{
+const double earth_radius = 6371.0088;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the kernel used for the given choice
+ */
+// ----------------------------------------------------------------------
+
+DistanceKernel SelectDistanceKernel(DistanceKernel theKernel)
+{
+  if (theKernel == DistanceKernel::Scalar || !avx2_supported())
+    return DistanceKernel::Scalar;
+  return DistanceKernel::AVX2;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Distance in kilometers between two points
+ */
+// ----------------------------------------------------------------------
+
+double GreatCircleDistance(double theLongitude1,
+                           double theLatitude1,
+                           double theLongitude2,
+                           double theLatitude2)
+{
+  return haversine(theLongitude1,
+                   theLatitude1,
+                   std::cos(deg * theLatitude1),
+                   theLongitude2,
+                   theLatitude2);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Distances in kilometers from a point to each of the given points
+ */
+// ----------------------------------------------------------------------
+
+void GreatCircleDistances(float theLongitude,
+                          float theLatitude,
+                          const float* theLongitudes,
+                          const float* theLatitudes,
+                          std::size_t theCount,
+                          float* theDistances,
+                          DistanceKernel theKernel)
+{
+  try
+  {
+#ifdef LOCUS_X86
+    if (SelectDistanceKernel(theKernel) == DistanceKernel::AVX2)
+    {
+      distances_avx2(
+          theLongitude, theLatitude, theLongitudes, theLatitudes, theCount, theDistances);
+      return;
+    }
+#endif
+    distances_scalar(
+        theLongitude, theLatitude, theLongitudes, theLatitudes, theCount, theDistances);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
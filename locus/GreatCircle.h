@@ -0,0 +1,52 @@
+// ======================================================================
+/*!
+ * \brief Great circle distances
+ *
+ * Haversine distances on a sphere with the mean radius of the earth.
+ * The distances from one point to arrays of points, such as the
+ * columns of a LocationStore, are calculated with AVX2 instructions
+ * eight points at a time when the processor supports them, and with a
+ * scalar loop otherwise. The vectorized kernel uses single precision
+ * polynomial approximations and agrees with the scalar one to within a
+ * few meters, which is well below the difference between the sphere
+ * and the spheroid used by PostGIS.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+
+namespace Locus
+{
+// Mean radius of the earth in kilometers
+extern const double earth_radius;
+
+enum class DistanceKernel
+{
+  Automatic,  // Fastest one supported by the processor
+  Scalar,
+  AVX2
+};
+
+// Kernel used for the given choice, AVX2 falls back to scalar if unsupported
+DistanceKernel SelectDistanceKernel(DistanceKernel theKernel = DistanceKernel::Automatic);
+
+// Distance in kilometers between two points given in degrees
+double GreatCircleDistance(double theLongitude1,
+                           double theLatitude1,
+                           double theLongitude2,
+                           double theLatitude2);
+
+// Distances in kilometers from a point to each of the given points
+void GreatCircleDistances(float theLongitude,
+                          float theLatitude,
+                          const float* theLongitudes,
+                          const float* theLatitudes,
+                          std::size_t theCount,
+                          float* theDistances,
+                          DistanceKernel theKernel = DistanceKernel::Automatic);
+
+}  // namespace Locus
+
+// ======================================================================
@@ -1,29 +1,98 @@
 #include "ISO639.h"
-#include <boost/regex.hpp>
 #include <macgyver/Exception.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
+
+namespace
+{
+// Tables for codes of 2 and 3 letters packed into 5 bits each
+const std::size_t size_2 = 1U << 10U;
+const std::size_t size_3 = 1U << 15U;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Pack a code of lowercase ASCII letters, returns 0 if not possible
+ */
+// ----------------------------------------------------------------------
+
+std::size_t pack(std::string_view code, std::size_t length)
+{
+  if (code.size() != length)
+    return 0;
+
+  std::size_t ret = 0;
+  for (char c : code)
+  {
+    if (c < 'a' || c > 'z')
+      return 0;
+    ret = (ret << 5U) | static_cast<std::size_t>(c - 'a' + 1);
+  }
+  return ret;
+}
+
+std::string quote(const std::string& code)
+{
+  std::string ret = "'";
+  for (char c : code)
+  {
+    if (c == '\'')
+      ret += '\'';
+    ret += c;
+  }
+  ret += '\'';
+  return ret;
+}
+
+Locus::ISO639::Codes make_codes(const Locus::ISO639::Entry& entry)
+{
+  Locus::ISO639::Codes ret;
+  ret.codes.push_back(entry.iso639_3);
+  if (entry.iso639_2 && (entry.iso639_2 != entry.iso639_3))
+    ret.codes.push_back(*entry.iso639_2);
+  if (entry.iso639_1)
+    ret.codes.push_back(*entry.iso639_1);
+
+  for (const auto& code : ret.codes)
+  {
+    if (!ret.sql_list.empty())
+      ret.sql_list += ", ";
+    ret.sql_list += quote(code);
+  }
+
+  if (ret.codes.size() == 1)
+    ret.sql_condition = "=" + ret.sql_list;
+  else
+    ret.sql_condition = " in (" + ret.sql_list + ") ";
+
+  return ret;
+}
+
+}  // namespace
+
+Locus::ISO639::ISO639() : iso639_1_index(size_2), iso639_2_index(size_3), iso639_3_index(size_3)
+{
+}
 
 Locus::ISO639::ISO639(Fmi::Database::PostgreSQLConnection& conn,
                       const std::vector<std::string>& special_codes)
+    : ISO639()
 {
   std::string sql = "select iso_639_1, iso_639_2, iso_639_3, name from languages";
   pqxx::result res = conn.executeNonTransaction(sql);
 
-  for (pqxx::result::const_iterator row = res.begin(); row != res.end(); ++row)
+  entries.reserve(res.size() + special_codes.size());
+  codes.reserve(res.size() + special_codes.size());
+
+  for (const auto& row : res)
   {
     Entry entry;
-    entry.iso639_3 = row["iso_639_3"].as<std::string>();
-    entry.name = row["name"].as<std::string>();
-    const auto& c1 = row["iso_639_1"];
-    if (!c1.is_null())
-    {
-      entry.iso639_1 = c1.as<std::string>();
-    }
-    const auto& c2 = row["iso_639_2"];
-    if (!c2.is_null())
-    {
-      entry.iso639_2 = c2.as<std::string>();
-    }
+    entry.iso639_3 = row[2].as<std::string>();
+    entry.name = row[3].as<std::string>();
+    if (!row[0].is_null())
+      entry.iso639_1 = row[0].as<std::string>();
+    if (!row[1].is_null())
+      entry.iso639_2 = row[1].as<std::string>();
     try
     {
       add(entry);
@@ -42,76 +111,128 @@ Locus::ISO639::ISO639(Fmi::Database::PostgreSQLConnection& conn,
 
 void Locus::ISO639::add(const Locus::ISO639::Entry& entry)
 {
-  const boost::regex r_c2("[a-z][a-z]");
-  const boost::regex r_c3("[a-z][a-z][a-z]");
-  if (!boost::regex_match(entry.iso639_3, r_c3))
-  {
-    throw Fmi::Exception(BCP, "Invalid ISO 639-3 language code " + entry.iso639_3);
-  }
+  // Validate everything before modifying anything
 
-  auto i3 = iso639_3_map.emplace(entry.iso639_3, entry);
-  if (!i3.second)
-  {
+  const std::size_t key3 = pack(entry.iso639_3, 3);
+  if (key3 == 0)
+    throw Fmi::Exception(BCP, "Invalid ISO 639-3 language code " + entry.iso639_3);
+  if (iso639_3_index[key3] != 0)
     throw Fmi::Exception(BCP, "Duplicate ISO 639-3 language code " + entry.iso639_3);
-  }
-  const Locus::ISO639::Entry* current = &i3.first->second;
+
+  std::size_t key1 = 0;
   if (entry.iso639_1)
   {
-    if (!boost::regex_match(*entry.iso639_1, r_c2))
-    {
+    key1 = pack(*entry.iso639_1, 2);
+    if (key1 == 0)
       throw Fmi::Exception(BCP, "Invalid ISO 639-1 language code " + *entry.iso639_1);
-    }
-    auto i1 = iso639_1_map.emplace(*entry.iso639_1, current);
-    if (!i1.second)
-    {
+    if (iso639_1_index[key1] != 0)
       throw Fmi::Exception(BCP, "Duplicate ISO 639-1 language code " + *entry.iso639_1);
-    }
   }
 
+  std::size_t key2 = 0;
   if (entry.iso639_2 && (*entry.iso639_2 != entry.iso639_3))
   {
-    if (!boost::regex_match(*entry.iso639_2, r_c3))
-    {
+    key2 = pack(*entry.iso639_2, 3);
+    if (key2 == 0)
       throw Fmi::Exception(BCP, "Invalid ISO 639-2 language code " + *entry.iso639_2);
-    }
-    auto i2 = iso639_2_map.emplace(*entry.iso639_2, current);
-    if (!i2.second)
-    {
+    if (iso639_2_index[key2] != 0)
       throw Fmi::Exception(BCP, "Duplicate ISO 639-2 language code " + *entry.iso639_2);
-    }
   }
+
+  if (entries.size() >= std::numeric_limits<Index>::max())
+    throw Fmi::Exception(BCP, "Too many ISO 639 language codes");
+
+  entries.push_back(entry);
+  codes.push_back(make_codes(entry));
+  const auto index = static_cast<Index>(entries.size());
+
+  iso639_3_index[key3] = index;
+  if (key1 != 0)
+    iso639_1_index[key1] = index;
+  if (key2 != 0)
+    iso639_2_index[key2] = index;
 }
 
 void Locus::ISO639::add_special_code(const std::string& code)
 {
+  if (find_index(code))
+    return;
+
+  if (entries.size() >= std::numeric_limits<Index>::max())
+    throw Fmi::Exception(BCP, "Too many ISO 639 language codes");
+
   Entry entry;
   entry.iso639_3 = code;
-  iso639_3_map.emplace(code, entry);
+  entries.push_back(entry);
+  codes.push_back(make_codes(entry));
+  const auto index = static_cast<Index>(entries.size());
+
+  const std::size_t key3 = pack(code, 3);
+  if (key3 != 0)
+    iso639_3_index[key3] = index;
+  else
+  {
+    auto pos = std::lower_bound(other_codes.begin(),
+                                other_codes.end(),
+                                code,
+                                [](const auto& item, const std::string& value)
+                                { return item.first < value; });
+    other_codes.emplace(pos, code, index);
+  }
+  special_codes.push_back(code);
 }
 
-std::optional<Locus::ISO639::Entry> Locus::ISO639::get(const std::string& name) const
+std::optional<std::size_t> Locus::ISO639::find_index(std::string_view name) const
 {
-  if (name.length() == 2)
+  Index index = 0;
+  if (name.size() == 2)
   {
-    auto it = iso639_1_map.find(name);
-    if (it == iso639_1_map.end())
-      return std::nullopt;
+    const std::size_t key = pack(name, 2);
+    if (key != 0)
+      index = iso639_1_index[key];
+  }
+  else if (name.size() == 3)
+  {
+    const std::size_t key = pack(name, 3);
+    if (key != 0)
+    {
+      index = iso639_3_index[key];
+      if (index == 0)
+        index = iso639_2_index[key];
+    }
+  }
 
-    return *it->second;
+  // Special codes which cannot be packed
+  if (index == 0 && !other_codes.empty())
+  {
+    auto pos = std::lower_bound(other_codes.begin(),
+                                other_codes.end(),
+                                name,
+                                [](const auto& item, std::string_view value)
+                                { return item.first < value; });
+    if (pos != other_codes.end() && pos->first == name)
+      index = pos->second;
   }
 
-  if (name.length() < 3)
+  if (index == 0)
     return std::nullopt;
+  return index - 1U;
+}
 
-  auto it1 = iso639_3_map.find(name);
-  if (it1 != iso639_3_map.end())
-    return it1->second;
-
-  auto it2 = iso639_2_map.find(name);
-  if (it2 == iso639_2_map.end())
+std::optional<Locus::ISO639::Entry> Locus::ISO639::get(const std::string& name) const
+{
+  const Entry* entry = find(name);
+  if (!entry)
     return std::nullopt;
+  return *entry;
+}
 
-  return *it2->second;
+const Locus::ISO639::Entry* Locus::ISO639::find(std::string_view name) const
+{
+  const auto index = find_index(name);
+  if (!index)
+    return nullptr;
+  return &entries[*index];
 }
 
 std::ostream& Locus::operator<<(std::ostream& os, const Locus::ISO639::Entry& entry)
@@ -131,24 +252,18 @@ std::ostream& Locus::operator<<(std::ostream& os, const Locus::ISO639::Entry& en
 
 std::vector<std::string> Locus::ISO639::get_codes(const std::string& name) const
 {
-  std::vector<std::string> result;
-  std::optional<Entry> entry = get(name);
-  if (entry)
-  {
-    result.push_back(entry->iso639_3);
-    if (entry->iso639_2 && (entry->iso639_2 != entry->iso639_3))
-    {
-      result.push_back(*entry->iso639_2);
-    }
-    if (entry->iso639_1)
-    {
-      result.push_back(*entry->iso639_1);
-    }
-  }
-  else
-  {
-    // FIXME: do we need this
-    result.push_back(name);
-  }
-  return result;
+  const Codes* codes = find_codes(name);
+  if (codes)
+    return codes->codes;
+
+  // FIXME: do we need this
+  return {name};
+}
+
+const Locus::ISO639::Codes* Locus::ISO639::find_codes(std::string_view name) const
+{
+  const auto index = find_index(name);
+  if (!index)
+    return nullptr;
+  return &codes[*index];
 }
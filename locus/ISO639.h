@@ -1,10 +1,12 @@
 #pragma once
 
 #include <macgyver/PostgreSQLConnection.h>
-#include <map>
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace Locus
@@ -13,6 +15,10 @@ namespace Locus
  *   @brief Provides mapping of ISO 639 language code (all 3 types)
  *
  *   See https://en.wikipedia.org/wiki/List_of_ISO_639-1_codes
+ *
+ *   Codes of 2-3 lowercase letters are packed into 5 bits per letter
+ *   and used directly as indexes to flat tables, other special codes
+ *   are kept in a small sorted table.
  */
 class ISO639
 {
@@ -25,7 +31,15 @@ class ISO639
     std::string name;
   };
 
-  ISO639() = default;
+  // Codes of a language precomputed for building SQL statements
+  struct Codes
+  {
+    std::vector<std::string> codes;  // ISO 639-3, 639-2 and 639-1 codes
+    std::string sql_list;            // Quoted codes separated by commas
+    std::string sql_condition;       // For example "='fi'" or " in ('fin', 'fi') "
+  };
+
+  ISO639();
   ISO639(Fmi::Database::PostgreSQLConnection& conn,
          const std::vector<std::string>& special_codes = std::vector<std::string>());
 
@@ -34,12 +48,31 @@ class ISO639
 
   std::optional<Entry> get(const std::string& name) const;
 
+  // Returns nullptr for unknown languages. Does not allocate.
+  const Entry* find(std::string_view name) const;
+
   std::vector<std::string> get_codes(const std::string& name) const;
 
+  // Returns nullptr for unknown languages. Does not allocate.
+  const Codes* find_codes(std::string_view name) const;
+
+  const std::vector<std::string>& get_special_codes() const { return special_codes; }
+
  private:
-  std::map<std::string, const Entry*> iso639_1_map;
-  std::map<std::string, const Entry*> iso639_2_map;
-  std::map<std::string, Entry> iso639_3_map;
+  // Position of an entry plus one, zero for no entry
+  using Index = std::uint16_t;
+
+  std::optional<std::size_t> find_index(std::string_view name) const;
+
+  std::vector<Entry> entries;
+  std::vector<Codes> codes;  // Codes of each entry
+
+  std::vector<Index> iso639_1_index;  // Packed 2 letter codes
+  std::vector<Index> iso639_2_index;  // Packed 3 letter codes
+  std::vector<Index> iso639_3_index;  // Packed 3 letter codes, including special ones
+  std::vector<std::pair<std::string, Index>> other_codes;  // Sorted special codes
+
+  std::vector<std::string> special_codes;
 };
 
 std::ostream& operator<<(std::ostream& os, const ISO639::Entry& entry);
@@ -0,0 +1,555 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::LocationStore
+ */
+// ======================================================================
+
+#include "LocationStore.h"
+#include "BulkLoader.h"
+#include "GreatCircle.h"
+#include <macgyver/Exception.h>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+// Columns of the load query, in this order
+const char* location_query =
+    "SELECT id, name, lon, lat, population, elevation, dem, features_code, countries_iso2,"
+    " timezone, municipalities_id FROM geonames WHERE timezone IS NOT NULL ORDER BY id";
+
+enum LoadColumn
+{
+  eId,
+  eName,
+  eLongitude,
+  eLatitude,
+  ePopulation,
+  eElevation,
+  eDem,
+  eFeature,
+  eIso2,
+  eTimeZone,
+  eMunicipality,
+  eColumnCount
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Parse a number from a COPY field, NULL is zero
+ *
+ * GCC 8 has from_chars for integers only, floating point numbers are
+ * parsed with the locale independent pqxx conversion.
+ */
+// ----------------------------------------------------------------------
+
+template <typename T>
+T parse_number(const std::optional<std::string_view>& theField)
+{
+  T value{};
+  if (!theField)
+    return value;
+
+  if constexpr (std::is_integral_v<T>)
+  {
+    const char* end = theField->data() + theField->size();
+    const auto result = std::from_chars(theField->data(), end, value);
+    if (result.ec != std::errc() || result.ptr != end)
+      throw Fmi::Exception(BCP, "Invalid number in location data")
+          .addParameter("Value", std::string(*theField));
+    return value;
+  }
+  else
+  {
+    try
+    {
+      return pqxx::from_string<T>(*theField);
+    }
+    catch (...)
+    {
+      throw Fmi::Exception::Trace(BCP, "Invalid number in location data")
+          .addParameter("Value", std::string(*theField));
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Lookup table of accepted dictionary ids, empty values accept all
+ */
+// ----------------------------------------------------------------------
+
+std::vector<unsigned char> accepted_codes(const Locus::LocationStore::Dictionary& theDictionary,
+                                          const std::vector<std::string>& theValues)
+{
+  std::vector<unsigned char> accepted(theDictionary.size(), theValues.empty() ? 1 : 0);
+  for (const auto& value : theValues)
+  {
+    auto code = theDictionary.find(value);
+    if (code)
+      accepted[*code] = 1;
+  }
+  return accepted;
+}
+
+}  // namespace
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the id of a value, adding it if necessary
+ */
+// ----------------------------------------------------------------------
+
+LocationStore::code_type LocationStore::Dictionary::add(std::string_view theValue)
+{
+  try
+  {
+    std::string value(theValue);
+    auto pos = codes.find(value);
+    if (pos != codes.end())
+      return pos->second;
+
+    if (values.size() > std::numeric_limits<code_type>::max())
+      throw Fmi::Exception(BCP, "Too many distinct values in location store dictionary");
+
+    const auto code = static_cast<code_type>(values.size());
+    values.push_back(value);
+    codes.emplace(std::move(value), code);
+    return code;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the id of a value if it is in the dictionary
+ */
+// ----------------------------------------------------------------------
+
+std::optional<LocationStore::code_type> LocationStore::Dictionary::find(
+    std::string_view theValue) const
+{
+  try
+  {
+    auto pos = codes.find(std::string(theValue));
+    if (pos == codes.end())
+      return {};
+    return pos->second;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Load the locations with timezones from the geonames table
+ *
+ * Each batch is parsed into a store of its own in a worker thread, and
+ * the batches are then appended in result order. Existing locations
+ * are discarded. The connection must not have an open transaction,
+ * see BulkLoader.
+ */
+// ----------------------------------------------------------------------
+
+void LocationStore::load(pqxx::connection& theConnection, unsigned int theThreads)
+{
+  try
+  {
+    BulkLoader loader(theConnection, theThreads);
+
+    auto batches = loader.load<LocationStore>(
+        location_query,
+        [](LocationStore& theStore, const BulkLoader::Fields& theFields)
+        {
+          if (theFields.size() != eColumnCount)
+            throw Fmi::Exception(BCP, "Unexpected number of columns in location data");
+
+          int elevation = parse_number<int>(theFields[eElevation]);
+          if (elevation == 0)
+            elevation = parse_number<int>(theFields[eDem]);
+
+          theStore.add(parse_number<int>(theFields[eId]),
+                       theFields[eName].value_or("NULL"),
+                       parse_number<float>(theFields[eLongitude]),
+                       parse_number<float>(theFields[eLatitude]),
+                       parse_number<unsigned int>(theFields[ePopulation]),
+                       elevation,
+                       theFields[eFeature].value_or(""),
+                       theFields[eIso2].value_or(""),
+                       theFields[eTimeZone].value_or(""),
+                       parse_number<int>(theFields[eMunicipality]));
+        });
+
+    *this = LocationStore();
+    reserve(loader.statistics().rows);
+    for (const auto& batch : batches)
+      append(batch);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to load location store");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Add a location
+ */
+// ----------------------------------------------------------------------
+
+void LocationStore::add(int theId,
+                        std::string_view theName,
+                        float theLongitude,
+                        float theLatitude,
+                        unsigned int thePopulation,
+                        int theElevation,
+                        std::string_view theFeature,
+                        std::string_view theIso2,
+                        std::string_view theTimeZone,
+                        int theMunicipality)
+{
+  try
+  {
+    if (ids.size() >= std::numeric_limits<index_type>::max())
+      throw Fmi::Exception(BCP, "Too many locations for location store");
+    if (name_heap.size() + theName.size() > std::numeric_limits<std::uint32_t>::max())
+      throw Fmi::Exception(BCP, "Location store name heap is full");
+
+    if (!ids.empty() && theId <= ids.back())
+      ids_sorted = false;
+
+    ids.push_back(theId);
+    lons.push_back(theLongitude);
+    lats.push_back(theLatitude);
+    populations.push_back(thePopulation);
+    elevations.push_back(theElevation);
+    features.push_back(feature_dict.add(theFeature));
+    countries.push_back(country_dict.add(theIso2));
+    timezones.push_back(timezone_dict.add(theTimeZone));
+    municipalities.push_back(theMunicipality);
+
+    name_heap.append(theName);
+    name_ends.push_back(static_cast<std::uint32_t>(name_heap.size()));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Append all locations of another store
+ *
+ * The dictionary ids of the other store are translated once per
+ * distinct value instead of once per location.
+ */
+// ----------------------------------------------------------------------
+
+void LocationStore::append(const LocationStore& theOther)
+{
+  try
+  {
+    if (theOther.empty())
+      return;
+
+    if (size() + theOther.size() > std::numeric_limits<index_type>::max())
+      throw Fmi::Exception(BCP, "Too many locations for location store");
+    if (name_heap.size() + theOther.name_heap.size() > std::numeric_limits<std::uint32_t>::max())
+      throw Fmi::Exception(BCP, "Location store name heap is full");
+
+    const auto translation = [](Dictionary& theTarget, const Dictionary& theSource)
+    {
+      std::vector<code_type> codes;
+      codes.reserve(theSource.size());
+      for (std::size_t i = 0; i < theSource.size(); i++)
+        codes.push_back(theTarget.add(theSource[static_cast<code_type>(i)]));
+      return codes;
+    };
+
+    const auto append_codes = [](std::vector<code_type>& theTarget,
+                                 const std::vector<code_type>& theSource,
+                                 const std::vector<code_type>& theTranslation)
+    {
+      for (const auto code : theSource)
+        theTarget.push_back(theTranslation[code]);
+    };
+
+    const auto append_values = [](auto& theTarget, const auto& theSource)
+    { theTarget.insert(theTarget.end(), theSource.begin(), theSource.end()); };
+
+    if (!empty() && (!theOther.ids_sorted || theOther.ids.front() <= ids.back()))
+      ids_sorted = false;
+    if (empty())
+      ids_sorted = theOther.ids_sorted;
+
+    append_values(ids, theOther.ids);
+    append_values(lons, theOther.lons);
+    append_values(lats, theOther.lats);
+    append_values(populations, theOther.populations);
+    append_values(elevations, theOther.elevations);
+    append_values(municipalities, theOther.municipalities);
+
+    append_codes(features, theOther.features, translation(feature_dict, theOther.feature_dict));
+    append_codes(countries, theOther.countries, translation(country_dict, theOther.country_dict));
+    append_codes(
+        timezones, theOther.timezones, translation(timezone_dict, theOther.timezone_dict));
+
+    const auto offset = static_cast<std::uint32_t>(name_heap.size());
+    name_heap += theOther.name_heap;
+    for (const auto end : theOther.name_ends)
+      name_ends.push_back(offset + end);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Reserve space for the given number of locations
+ */
+// ----------------------------------------------------------------------
+
+void LocationStore::reserve(std::size_t theSize)
+{
+  try
+  {
+    ids.reserve(theSize);
+    lons.reserve(theSize);
+    lats.reserve(theSize);
+    populations.reserve(theSize);
+    elevations.reserve(theSize);
+    features.reserve(theSize);
+    countries.reserve(theSize);
+    timezones.reserve(theSize);
+    municipalities.reserve(theSize);
+    name_ends.reserve(theSize);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Row number of a location
+ */
+// ----------------------------------------------------------------------
+
+std::optional<LocationStore::index_type> LocationStore::find(int theId) const
+{
+  try
+  {
+    std::vector<int>::const_iterator pos;
+    if (ids_sorted)
+    {
+      pos = std::lower_bound(ids.begin(), ids.end(), theId);
+      if (pos != ids.end() && *pos != theId)
+        pos = ids.end();
+    }
+    else
+      pos = std::find(ids.begin(), ids.end(), theId);
+
+    if (pos == ids.end())
+      return {};
+    return static_cast<index_type>(pos - ids.begin());
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Name of a location
+ */
+// ----------------------------------------------------------------------
+
+std::string_view LocationStore::name(index_type theIndex) const
+{
+  const std::size_t start = (theIndex > 0 ? name_ends[theIndex - 1] : 0);
+  return std::string_view(name_heap).substr(start, name_ends[theIndex] - start);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Mask of the locations accepted by the filter
+ *
+ * The codes are translated into lookup tables of dictionary ids, after
+ * which each location is tested without branches so that the loop over
+ * the columns can be vectorized.
+ */
+// ----------------------------------------------------------------------
+
+std::vector<unsigned char> LocationStore::accepted(const Filter& theFilter) const
+{
+  try
+  {
+    const auto country_ok = accepted_codes(country_dict, theFilter.countries);
+    const auto feature_ok = accepted_codes(feature_dict, theFilter.features);
+
+    const unsigned int pop_min = theFilter.population_min;
+    const unsigned int pop_max =
+        (theFilter.population_max > 0 ? theFilter.population_max
+                                      : std::numeric_limits<unsigned int>::max());
+
+    const std::size_t n = size();
+    const unsigned int* pop = populations.data();
+    const code_type* country = countries.data();
+    const code_type* feature = features.data();
+    const unsigned char* country_table = country_ok.data();
+    const unsigned char* feature_table = feature_ok.data();
+
+    std::vector<unsigned char> mask(n);
+    unsigned char* ok = mask.data();
+
+    for (std::size_t i = 0; i < n; i++)
+      ok[i] = static_cast<unsigned char>((pop[i] >= pop_min) & (pop[i] <= pop_max) &
+                                         country_table[country[i]] & feature_table[feature[i]]);
+    return mask;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Row numbers of the locations accepted by the filter
+ */
+// ----------------------------------------------------------------------
+
+std::vector<LocationStore::index_type> LocationStore::select(const Filter& theFilter) const
+{
+  try
+  {
+    const auto mask = accepted(theFilter);
+
+    std::vector<index_type> ret;
+    for (std::size_t i = 0; i < mask.size(); i++)
+      if (mask[i])
+        ret.push_back(static_cast<index_type>(i));
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Locations near a point in distance order
+ *
+ * The distances to all locations are calculated with the vectorized
+ * kernel in a single pass over the coordinate columns. Ties are ordered
+ * by id like in the radius searches in the database.
+ */
+// ----------------------------------------------------------------------
+
+std::vector<LocationStore::Neighbour> LocationStore::nearest(float theLongitude,
+                                                             float theLatitude,
+                                                             float theRadius,
+                                                             std::size_t theLimit,
+                                                             const Filter& theFilter) const
+{
+  try
+  {
+    const auto mask = accepted(theFilter);
+
+    std::vector<float> distances(size());
+    GreatCircleDistances(
+        theLongitude, theLatitude, lons.data(), lats.data(), size(), distances.data());
+
+    const float radius = (theRadius > 0 ? theRadius : std::numeric_limits<float>::max());
+
+    std::vector<Neighbour> ret;
+    for (std::size_t i = 0; i < distances.size(); i++)
+      if (mask[i] && distances[i] <= radius)
+        ret.push_back(Neighbour{static_cast<index_type>(i), distances[i]});
+
+    const auto closer = [this](const Neighbour& a, const Neighbour& b)
+    {
+      if (a.distance != b.distance)
+        return a.distance < b.distance;
+      return ids[a.index] < ids[b.index];
+    };
+
+    if (theLimit > 0 && theLimit < ret.size())
+    {
+      std::partial_sort(ret.begin(), ret.begin() + theLimit, ret.end(), closer);
+      ret.resize(theLimit);
+    }
+    else
+      std::sort(ret.begin(), ret.end(), closer);
+
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Nearest location for each point
+ *
+ * The filter is evaluated once for all points, and the distance buffer
+ * is reused from point to point.
+ */
+// ----------------------------------------------------------------------
+
+std::vector<std::optional<LocationStore::Neighbour>> LocationStore::nearest(
+    const std::vector<Point>& thePoints, float theRadius, const Filter& theFilter) const
+{
+  try
+  {
+    const auto mask = accepted(theFilter);
+    const float radius = (theRadius > 0 ? theRadius : std::numeric_limits<float>::max());
+
+    std::vector<std::optional<Neighbour>> ret;
+    ret.reserve(thePoints.size());
+
+    std::vector<float> distances(size());
+    for (const auto& point : thePoints)
+    {
+      GreatCircleDistances(
+          point.first, point.second, lons.data(), lats.data(), size(), distances.data());
+
+      std::optional<Neighbour> best;
+      for (std::size_t i = 0; i < distances.size(); i++)
+      {
+        if (!mask[i] || distances[i] > radius)
+          continue;
+        if (!best || distances[i] < best->distance ||
+            (distances[i] == best->distance && ids[i] < ids[best->index]))
+          best = Neighbour{static_cast<index_type>(i), distances[i]};
+      }
+      ret.push_back(best);
+    }
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,157 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::LocationStore
+ *
+ * In-memory locations stored column by column. Each attribute is a
+ * contiguous array indexed by the row number, codes such as countries,
+ * feature codes and timezones are stored as small dictionary ids, and
+ * names are stored back to back in a single string heap. Filtering by
+ * country, feature code or population is then a tight loop over a few
+ * arrays instead of a walk over objects with several strings each.
+ *
+ * A store is filled by add() or by loading the geonames table with a
+ * BulkLoader, after which it is meant to be used read-only.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Locus
+{
+class LocationStore
+{
+ public:
+  using index_type = std::uint32_t;  // Row number
+  using code_type = std::uint16_t;   // Dictionary id
+
+  // Conditions for select(), empty lists and zero limits accept anything
+  struct Filter
+  {
+    // Not defaulted in the declaration so that Filter() can be a default argument
+    Filter() : population_min(0), population_max(0) {}
+
+    std::vector<std::string> countries;  // iso2 codes
+    std::vector<std::string> features;   // feature codes
+    unsigned int population_min;
+    unsigned int population_max;
+  };
+
+  // A location and its distance in kilometers from a point
+  struct Neighbour
+  {
+    index_type index;
+    float distance;
+  };
+
+  using Point = std::pair<float, float>;  // longitude, latitude
+
+  // Strings used by many locations, stored once
+  class Dictionary
+  {
+   public:
+    code_type add(std::string_view theValue);
+    std::optional<code_type> find(std::string_view theValue) const;
+    const std::string& operator[](code_type theCode) const { return values[theCode]; }
+    std::size_t size() const { return values.size(); }
+
+   private:
+    std::vector<std::string> values;
+    std::unordered_map<std::string, code_type> codes;
+  };
+
+  // Load the locations with timezones from the geonames table
+  void load(pqxx::connection& theConnection, unsigned int theThreads = 0);
+
+  void add(int theId,
+           std::string_view theName,
+           float theLongitude,
+           float theLatitude,
+           unsigned int thePopulation,
+           int theElevation,
+           std::string_view theFeature,
+           std::string_view theIso2,
+           std::string_view theTimeZone,
+           int theMunicipality = 0);
+
+  // Append all locations of another store
+  void append(const LocationStore& theOther);
+
+  void reserve(std::size_t theSize);
+  std::size_t size() const { return ids.size(); }
+  bool empty() const { return ids.empty(); }
+
+  // Row number of a location, binary search if the ids were added in order
+  std::optional<index_type> find(int theId) const;
+
+  // Row numbers of the locations accepted by the filter, in row order
+  std::vector<index_type> select(const Filter& theFilter) const;
+
+  // Locations accepted by the filter within the radius in kilometers, in
+  // distance and id order. Zero radius and limit mean no limit.
+  std::vector<Neighbour> nearest(float theLongitude,
+                                 float theLatitude,
+                                 float theRadius,
+                                 std::size_t theLimit,
+                                 const Filter& theFilter = Filter()) const;
+
+  // Nearest accepted location within the radius for each point, as in
+  // batch reverse geocoding
+  std::vector<std::optional<Neighbour>> nearest(const std::vector<Point>& thePoints,
+                                                float theRadius,
+                                                const Filter& theFilter = Filter()) const;
+
+  // Row attributes
+  int id(index_type theIndex) const { return ids[theIndex]; }
+  std::string_view name(index_type theIndex) const;
+  float longitude(index_type theIndex) const { return lons[theIndex]; }
+  float latitude(index_type theIndex) const { return lats[theIndex]; }
+  unsigned int population(index_type theIndex) const { return populations[theIndex]; }
+  int elevation(index_type theIndex) const { return elevations[theIndex]; }
+  const std::string& feature(index_type theIndex) const { return feature_dict[features[theIndex]]; }
+  const std::string& iso2(index_type theIndex) const { return country_dict[countries[theIndex]]; }
+  const std::string& timezone(index_type theIndex) const
+  {
+    return timezone_dict[timezones[theIndex]];
+  }
+  int municipality(index_type theIndex) const { return municipalities[theIndex]; }  // 0 if none
+
+  // Whole columns for vectorized processing
+  const std::vector<float>& longitudes() const { return lons; }
+  const std::vector<float>& latitudes() const { return lats; }
+
+ private:
+  std::vector<unsigned char> accepted(const Filter& theFilter) const;
+
+  std::vector<int> ids;
+  std::vector<float> lons;
+  std::vector<float> lats;
+  std::vector<unsigned int> populations;
+  std::vector<int> elevations;
+  std::vector<code_type> features;
+  std::vector<code_type> countries;
+  std::vector<code_type> timezones;
+  std::vector<int> municipalities;
+
+  std::string name_heap;
+  std::vector<std::uint32_t> name_ends;  // End of each name in the heap
+
+  Dictionary feature_dict;
+  Dictionary country_dict;
+  Dictionary timezone_dict;
+
+  bool ids_sorted = true;
+};  // class LocationStore
+
+}  // namespace Locus
+
+// ======================================================================
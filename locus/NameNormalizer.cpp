@@ -0,0 +1,106 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::NameNormalizer
+ */
+// ======================================================================
+
+#include "NameNormalizer.h"
+#include <macgyver/Exception.h>
+#include <memory>
+#include <unicode/translit.h>
+#include <unicode/unistr.h>
+
+namespace
+{
+// Decompose, drop the accents and fold what does not decompose (ø, æ, ß etc)
+const char* fold_rules = "NFKD; [:Nonspacing Mark:] Remove; Latin-ASCII; Lower; NFC";
+const char* transliterate_rules =
+    "Any-Latin; NFKD; [:Nonspacing Mark:] Remove; Latin-ASCII; Lower; NFC";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create a transliterator for the given rules
+ *
+ * Transliterators are not thread safe, hence each thread creates
+ * its own.
+ */
+// ----------------------------------------------------------------------
+
+std::unique_ptr<icu::Transliterator> create_transliterator(const char* theRules)
+{
+  UErrorCode status = U_ZERO_ERROR;
+  std::unique_ptr<icu::Transliterator> ret(icu::Transliterator::createInstance(
+      icu::UnicodeString::fromUTF8(theRules), UTRANS_FORWARD, status));
+  if (U_FAILURE(status) || !ret)
+    throw Fmi::Exception(BCP, "Failed to create ICU transliterator")
+        .addParameter("Rules", theRules)
+        .addParameter("Error", u_errorName(status));
+  return ret;
+}
+
+icu::Transliterator& get_transliterator(bool theTransliterate)
+{
+  thread_local std::unique_ptr<icu::Transliterator> folder;
+  thread_local std::unique_ptr<icu::Transliterator> transliterator;
+
+  auto& ret = (theTransliterate ? transliterator : folder);
+  if (!ret)
+    ret = create_transliterator(theTransliterate ? transliterate_rules : fold_rules);
+  return *ret;
+}
+
+}  // namespace
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ *
+ * \param theTransliterate True if non-Latin scripts should be transliterated
+ */
+// ----------------------------------------------------------------------
+
+NameNormalizer::NameNormalizer(bool theTransliterate) : transliterate(theTransliterate) {}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the search key for a UTF-8 encoded name
+ *
+ * SQL wildcards and other ASCII punctuation are preserved.
+ */
+// ----------------------------------------------------------------------
+
+std::string NameNormalizer::normalize(const std::string& theName) const
+{
+  try
+  {
+    // Plain lower case ASCII is already normalized
+    bool ascii = true;
+    for (char c : theName)
+    {
+      if ((c & 0x80) != 0 || (c >= 'A' && c <= 'Z'))
+      {
+        ascii = false;
+        break;
+      }
+    }
+    if (ascii)
+      return theName;
+
+    auto name = icu::UnicodeString::fromUTF8(theName);
+    get_transliterator(transliterate).transliterate(name);
+
+    std::string ret;
+    name.toUTF8String(ret);
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!").addParameter("Name", theName);
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,46 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::NameNormalizer
+ *
+ * Produces search keys for place names which are insensitive to case
+ * and diacritics, so that for example "Aanekoski" and "ÄÄNEKOSKI" both
+ * give "aanekoski". The folding uses the ICU Latin-ASCII rules, which
+ * are also the source of the rules of the PostgreSQL unaccent extension,
+ * hence the keys match those computed in the database by
+ *
+ * \code
+ * CREATE FUNCTION locus_fold(text) RETURNS text AS
+ *   $$ SELECT lower(public.unaccent('public.unaccent'::regdictionary, $1)) $$
+ *   LANGUAGE sql IMMUTABLE PARALLEL SAFE STRICT;
+ * \endcode
+ *
+ * The keys match only if lower() of the database folds the same letters
+ * as the ICU Lower rule. lower() follows LC_CTYPE of the database, hence
+ * with a C or POSIX ctype it folds ASCII only, and upper case letters of
+ * for example Cyrillic or Greek names would not match. Use a UTF-8 ctype
+ * such as en_US.UTF-8 for the database.
+ *
+ * Optionally other scripts are transliterated to Latin first.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <string>
+
+namespace Locus
+{
+class NameNormalizer
+{
+ public:
+  explicit NameNormalizer(bool theTransliterate = false);
+
+  std::string normalize(const std::string& theName) const;
+
+ private:
+  bool transliterate;
+};  // class NameNormalizer
+
+}  // namespace Locus
+
+// ======================================================================
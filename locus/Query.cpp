@@ -5,6 +5,7 @@
 // ======================================================================
 
 #include "Query.h"
+#include "NameNormalizer.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -12,13 +13,26 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/locale.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/regex.hpp>
 #include <fmt/format.h>
 #include <macgyver/Exception.h>
 #include <macgyver/Join.h>
 #include <macgyver/StringConversion.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
 
 using namespace std;
 
@@ -35,6 +49,208 @@ const char* CLIENT_ENCODING = "UTF8";
 const boost::locale::generator locale_generator;
 const std::locale default_locale = locale_generator("fi_FI.UTF-8");
 
+// Search keys for diacritic insensitive searches, see locus_fold_ddl
+const Locus::NameNormalizer name_normalizer;
+
+// Database side equivalent of NameNormalizer without transliteration
+const char* locus_fold_ddl =
+    "CREATE OR REPLACE FUNCTION locus_fold(text) RETURNS text AS "
+    "$$ SELECT lower(public.unaccent('public.unaccent'::regdictionary, $1)) $$ "
+    "LANGUAGE sql IMMUTABLE PARALLEL SAFE STRICT";
+
+// Maximum number of candidates taken from each name table in fuzzy searches
+const int fuzzy_candidate_limit = 200;
+
+// Delay before retrying a failed reload of in-memory data
+const auto refresh_retry_delay = std::chrono::seconds(60);
+
+// More changed places than this are applied by reloading all name variants
+const std::size_t max_name_variant_changes = 10000;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Changes to alternate_geonames not yet applied to the name variants
+ */
+// ----------------------------------------------------------------------
+
+struct NameVariantChanges
+{
+  std::mutex mutex;
+  std::set<int> ids;        // Places whose names have changed
+  bool everything = false;  // All names may have changed
+};
+
+NameVariantChanges& pending_name_variant_changes()
+{
+  static NameVariantChanges changes;
+  return changes;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Record a changed place, or a change of all places if the key is not an id
+ */
+// ----------------------------------------------------------------------
+
+void add_name_variant_change(const std::string& theKey)
+{
+  auto& changes = pending_name_variant_changes();
+  std::lock_guard<std::mutex> lock(changes.mutex);
+
+  int id = 0;
+  const char* end = theKey.data() + theKey.size();
+  const auto result = std::from_chars(theKey.data(), end, id);
+
+  if (theKey.empty() || result.ec != std::errc() || result.ptr != end)
+    changes.everything = true;
+  else
+    changes.ids.insert(id);
+
+  if (changes.ids.size() > max_name_variant_changes)
+    changes.everything = true;
+  if (changes.everything)
+    changes.ids.clear();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Runs refreshes of in-memory data outside the request threads
+ *
+ * At most one refresh runs at a time. The destructor waits for it to
+ * finish, hence the worker never outlives the data it updates.
+ */
+// ----------------------------------------------------------------------
+
+class BackgroundRefresh
+{
+ public:
+  ~BackgroundRefresh()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (worker.joinable())
+      worker.join();
+  }
+
+  // Returns false if a refresh is already running. The task must not throw.
+  bool start(std::function<void()> theTask)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+      return false;
+    if (worker.joinable())
+      worker.join();
+    running = true;
+    worker = std::thread(
+        [this, task = std::move(theTask)]()
+        {
+          task();
+          running = false;
+        });
+    return true;
+  }
+
+ private:
+  std::mutex mutex;
+  std::thread worker;
+  std::atomic<bool> running{false};
+};
+
+BackgroundRefresh& background_refresh()
+{
+  pending_name_variant_changes();  // Constructed first so that it is destroyed after the worker
+  static BackgroundRefresh refresh;
+  return refresh;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief SQL for the priority of a code as given by QueryOptions::GetCountryPriority
+ *
+ * The priority is the position of the code in the list, NULL values get
+ * zero like in Query::FetchNameCandidates. Only codes which QueryOptions
+ * can prioritize (at most 5 letters or digits) are listed, hence they
+ * need not be quoted.
+ */
+// ----------------------------------------------------------------------
+
+std::string priority_order(const std::string& theColumn, const std::list<std::string>& theCodes)
+{
+  std::string sql = "CASE WHEN " + theColumn + " IS NULL THEN 0";
+  unsigned int priority = 1;
+  for (const auto& code : theCodes)
+  {
+    const bool valid =
+        (!code.empty() && code.size() <= 5 &&
+         std::all_of(code.begin(),
+                     code.end(),
+                     [](char c)
+                     {
+                       return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+                              (c >= 'a' && c <= 'z');
+                     }));
+    if (valid)
+    {
+      sql += " WHEN upper(" + theColumn + ")='" + Fmi::ascii_toupper_copy(code) +
+             "' THEN " + Fmi::to_string(priority);
+    }
+    ++priority;
+  }
+  sql += " ELSE " + Fmi::to_string(Locus::QueryOptions::default_priority) + " END";
+  return sql;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Changes session settings of a connection for the lifetime of the object
+ *
+ * The connection is shared by all queries, hence the settings are reset
+ * to their defaults also when the query using them fails.
+ */
+// ----------------------------------------------------------------------
+
+class SessionSettings
+{
+ public:
+  SessionSettings(const Fmi::Database::PostgreSQLConnection& theConn,
+                  const std::map<std::string, std::string>& theSettings)
+      : conn(theConn)
+  {
+    std::string sql;
+    for (const auto& setting : theSettings)
+    {
+      sql += (sql.empty() ? "SELECT " : ", ");
+      sql += "set_config(" + conn.quote(setting.first) + ", " + conn.quote(setting.second) +
+             ", false)";
+      names += (names.empty() ? "" : ",") + conn.quote(setting.first);
+    }
+    conn.executeNonTransaction(sql);
+  }
+
+  ~SessionSettings()
+  {
+    try
+    {
+      conn.executeNonTransaction(
+          "SELECT set_config(name, reset_val, false) FROM pg_settings WHERE name IN (" + names +
+          ")");
+    }
+    catch (...)
+    {
+      // The connection is broken and its session is lost anyway
+    }
+  }
+
+  SessionSettings(const SessionSettings&) = delete;
+  SessionSettings& operator=(const SessionSettings&) = delete;
+
+ private:
+  const Fmi::Database::PostgreSQLConnection& conn;
+  std::string names;
+};
+
+// Initial arena of build_locations, which is on the stack and grows if needed
+const std::size_t initial_arena_bytes = 4096;
+
 // ----------------------------------------------------------------------
 /*!
  * \brief Convert from UTF-8 to given locale
@@ -74,26 +290,6 @@ string from_utf(const string& name, const string& encoding)
 }
 #endif
 
-// ----------------------------------------------------------------------
-/*!
- * \brief Utility algorithm to test if a container has a specific element
- */
-// ----------------------------------------------------------------------
-
-template <typename T, typename S>
-bool contains(const T& theContainer, const S& theObject)
-{
-  try
-  {
-    const auto it = find(theContainer.begin(), theContainer.end(), theObject);
-    return (it != theContainer.end());
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-
 std::optional<int> find_column(const pqxx::result& theResult, const std::string& theColumnName)
 {
   try
@@ -111,16 +307,19 @@ std::optional<int> find_column(const pqxx::result& theResult, const std::string&
   }
 }
 
+// Sorted unique values of a column
+
 template <typename ValueType>
-std::set<ValueType> get_unique_values(const pqxx::result& theResult,
-                                      const std::string& theColumnName)
+std::vector<ValueType> get_unique_values(const pqxx::result& theResult,
+                                         const std::string& theColumnName)
 {
   try
   {
-    std::set<ValueType> values;
+    std::vector<ValueType> values;
     auto column = find_column(theResult, theColumnName);
     if (column)
     {
+      values.reserve(theResult.size());
       for (const auto& row : theResult)
       {
         if (row.size() <= *column)
@@ -128,8 +327,10 @@ std::set<ValueType> get_unique_values(const pqxx::result& theResult,
         const auto& value = row[*column];
         if (value.is_null())
           continue;  // Skip null values
-        values.insert(value.as<ValueType>());
+        values.push_back(value.as<ValueType>());
       }
+      std::sort(values.begin(), values.end());
+      values.erase(std::unique(values.begin(), values.end()), values.end());
     }
     return values;
   }
@@ -139,6 +340,173 @@ std::set<ValueType> get_unique_values(const pqxx::result& theResult,
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Parse a numeric field without going through a string conversion
+ *
+ * Falls back to the pqxx conversion, and its error handling, if the text
+ * is not a plain number. Floating point numbers always use the pqxx
+ * conversion, since GCC 8 has from_chars for integers only.
+ */
+// ----------------------------------------------------------------------
+
+template <typename T>
+T parse_number(const pqxx::field& theField)
+{
+  if constexpr (std::is_integral_v<T>)
+  {
+    T value{};
+    const char* begin = theField.c_str();
+    const char* end = begin + theField.size();
+    const auto result = std::from_chars(begin, end, value);
+    if (result.ec == std::errc() && result.ptr == end)
+      return value;
+  }
+  return theField.as<T>();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Column numbers of a location result
+ *
+ * The columns are looked up once per result instead of once per field.
+ */
+// ----------------------------------------------------------------------
+
+int required_column(const pqxx::result& theResult, const std::string& theColumnName)
+{
+  const auto column = find_column(theResult, theColumnName);
+  if (!column)
+    throw Fmi::Exception(BCP, "Location result has no required column")
+        .addParameter("Column", theColumnName);
+  return *column;
+}
+
+struct LocationColumns
+{
+  explicit LocationColumns(const pqxx::result& theResult)
+      : id(required_column(theResult, "id")),
+        name(required_column(theResult, "name")),
+        ansiname(required_column(theResult, "ansiname")),
+        lat(required_column(theResult, "lat")),
+        lon(required_column(theResult, "lon")),
+        iso2(required_column(theResult, "iso2")),
+        features_code(required_column(theResult, "features_code")),
+        timezone(required_column(theResult, "timezone")),
+        municipalities_id(required_column(theResult, "municipalities_id")),
+        admin1(required_column(theResult, "admin1")),
+        population(required_column(theResult, "population")),
+        elevation(required_column(theResult, "elevation")),
+        dem(required_column(theResult, "dem")),
+        distance(find_column(theResult, "distance")),
+        bearing(find_column(theResult, "bearing"))
+  {
+  }
+
+  int id;
+  int name;
+  int ansiname;
+  int lat;
+  int lon;
+  int iso2;
+  int features_code;
+  int timezone;
+  int municipalities_id;
+  int admin1;
+  int population;
+  int elevation;
+  int dem;
+  std::optional<int> distance;  // Meters, only in lonlat searches
+  std::optional<int> bearing;   // Degrees, only in lonlat searches
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief ASCII case insensitive comparison with a key in lower case
+ */
+// ----------------------------------------------------------------------
+
+bool equals_folded(const std::string& theName, const std::string& theKey)
+{
+  if (theName.size() != theKey.size())
+    return false;
+
+  for (std::size_t i = 0; i < theName.size(); i++)
+  {
+    const char c = theName[i];
+    if ((c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c) != theKey[i])
+      return false;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Options for the SQL of name searches
+ *
+ * Names are searched in the language given by the name type, if any.
+ */
+// ----------------------------------------------------------------------
+
+Locus::QueryOptions name_search_options(const Locus::QueryOptions& theOptions)
+{
+  try
+  {
+    Locus::QueryOptions opts = theOptions;
+    if (!opts.GetNameType().empty())
+      opts.SetLanguage(opts.GetNameType());
+    return opts;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Bounding box containing all points within the given radius
+ *
+ * The polar radius of the earth and a safety margin are used so that the
+ * box is never smaller than the spheroidal circle used by PostGIS. The
+ * box covers all longitudes near the poles and when the circle crosses
+ * the antimeridian.
+ */
+// ----------------------------------------------------------------------
+
+struct BBox
+{
+  double xmin = -180;
+  double ymin = -90;
+  double xmax = 180;
+  double ymax = 90;
+};
+
+BBox radius_bbox(double theLongitude, double theLatitude, double theRadius)
+{
+  const double polar_radius = 6356.752;  // km
+  const double margin = 1.01;
+  const double deg = M_PI / 180;
+
+  const double d = margin * theRadius / polar_radius;  // angular distance
+  BBox box;
+  box.ymin = std::max(-90.0, theLatitude - d / deg);
+  box.ymax = std::min(90.0, theLatitude + d / deg);
+
+  // Maximum longitude difference within a spherical cap
+  const double s = std::sin(d) / std::cos(theLatitude * deg);
+  if (box.ymin > -90 && box.ymax < 90 && s < 1)
+  {
+    const double dlon = std::asin(s) / deg;
+    if (theLongitude - dlon >= -180 && theLongitude + dlon <= 180)
+    {
+      box.xmin = theLongitude - dlon;
+      box.xmax = theLongitude + dlon;
+    }
+  }
+  return box;
+}
+
 }  // namespace
 
 namespace Locus
@@ -167,14 +535,12 @@ Query::Query(const string& theHost,
   try
   {
     /* Make a connection to the database */
-    Fmi::Database::PostgreSQLConnectionOptions opt;
-    opt.host = theHost;
-    opt.username = theUser;
-    opt.password = thePass;
-    opt.database = theDatabase;
-    opt.encoding = CLIENT_ENCODING;
-    conn->open(opt);
-    // conn.open(theHost, theUser, thePass, theDatabase, CLIENT_ENCODING);
+    connection_options.host = theHost;
+    connection_options.username = theUser;
+    connection_options.password = thePass;
+    connection_options.database = theDatabase;
+    connection_options.encoding = CLIENT_ENCODING;
+    conn->open(connection_options);
   }
   catch (...)
   {
@@ -198,15 +564,32 @@ Query::Query(const string& theHost,
   try
   {
     /* Make a connection to the database */
-    Fmi::Database::PostgreSQLConnectionOptions opt;
-    opt.host = theHost;
-    opt.port = boost::lexical_cast<unsigned int>(thePort);
-    opt.username = theUser;
-    opt.password = thePass;
-    opt.database = theDatabase;
-    opt.encoding = CLIENT_ENCODING;
-    conn->open(opt);
-    // conn.open(theHost, theUser, thePass, theDatabase, CLIENT_ENCODING, thePort);
+    connection_options.host = theHost;
+    connection_options.port = boost::lexical_cast<unsigned int>(thePort);
+    connection_options.username = theUser;
+    connection_options.password = thePass;
+    connection_options.database = theDatabase;
+    connection_options.encoding = CLIENT_ENCODING;
+    conn->open(connection_options);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Connect with the options of another instance
+ */
+// ----------------------------------------------------------------------
+
+Query::Query(const Fmi::Database::PostgreSQLConnectionOptions& theOptions)
+    : conn(new Fmi::Database::PostgreSQLConnection), connection_options(theOptions)
+{
+  try
+  {
+    conn->open(connection_options);
   }
   catch (...)
   {
@@ -217,6 +600,11 @@ Query::Query(const string& theHost,
 // ----------------------------------------------------------------------
 /*!
  * \brief Activate the correct language
+ *
+ * Also pins the current generation of in-memory data so that the whole
+ * request sees a consistent state even if a reload happens meanwhile.
+ * The generation number is read before the snapshots are taken, hence
+ * it may be older than the data but never newer.
  */
 // ----------------------------------------------------------------------
 
@@ -224,6 +612,10 @@ void Query::SetOptions(const QueryOptions& theOptions)
 {
   try
   {
+    RefreshStaleData();
+    data_generation = CurrentDataGeneration();
+    iso639 = iso639_table().get();
+    preferred_names = name_variant_table().get();
     conn->setClientEncoding(theOptions.GetCharset());
   }
   catch (...)
@@ -232,6 +624,65 @@ void Query::SetOptions(const QueryOptions& theOptions)
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Reload in-memory data invalidated by change notifications
+ *
+ * Only one Query instance performs the reload, the others keep using
+ * the previous generation meanwhile. Data which has never been loaded
+ * is not loaded here either.
+ *
+ * The small language code table is reloaded in the calling request. The
+ * name variants may consist of millions of rows, hence their changes are
+ * applied in a background thread with a connection of its own, and the
+ * request continues with the current generation.
+ *
+ * A failed reload does not fail the request: the previous generation is
+ * still valid, hence it is kept in use and the reload is retried later.
+ */
+// ----------------------------------------------------------------------
+
+void Query::RefreshStaleData()
+{
+  auto& table = iso639_table();
+  if (table.generation() > 0 && table.claim_refresh())
+  {
+    try
+    {
+      load_iso639_table(table.get()->get_special_codes());
+    }
+    catch (...)
+    {
+      std::cerr << Fmi::Exception::Trace(BCP, "Failed to reload language codes") << '\n';
+      table.retry_after(refresh_retry_delay);
+    }
+  }
+
+  auto& variants = name_variant_table();
+  if (variants.generation() > 0 && variants.claim_refresh())
+  {
+    const auto options = connection_options;
+    const bool started = background_refresh().start(
+        [options]()
+        {
+          try
+          {
+            Query query(options);
+            query.ApplyNameVariantChanges();
+          }
+          catch (...)
+          {
+            std::cerr << Fmi::Exception::Trace(BCP, "Failed to update name variants") << '\n';
+            name_variant_table().retry_after(refresh_retry_delay);
+          }
+        });
+
+    // The running refresh may have taken the pending changes already
+    if (!started)
+      variants.invalidate();
+  }
+}
+
 // ----------------------------------------------------------------------
 /*!
  * SetDebug-mode on or off. Debug-mode prints sql-queries and
@@ -254,6 +705,24 @@ void Query::SetDebug(bool theFlag)
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the ranking of name search results
+ */
+// ----------------------------------------------------------------------
+
+void Query::SetRanking(const Ranking& theRanking)
+{
+  try
+  {
+    ranking = theRanking;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 void Query::cancel()
 {
   conn->cancel();
@@ -302,10 +771,28 @@ string Query::ResolveNameVariant(const QueryOptions& theOptions,
 std::map<int, std::string> Query::ResolveNameVariants(const QueryOptions& theOptions,
                                                       const vector<int>& theIds)
 {
+  std::map<int, std::string> retval;
+
+  // Use the preloaded names if there are any for the language
+
+  string language = theOptions.GetLanguage();
+  Fmi::ascii_tolower(language);
+
+  const auto cached = preferred_names->find(language);
+  if (cached != preferred_names->end())
+  {
+    for (const int id : theIds)
+    {
+      const auto* name = cached->second.find(id);
+      if (name)
+        retval[id] = *name;
+    }
+    return retval;
+  }
+
   map<SQLQueryParameterId, std::any> params;
   params[eQueryOptions] = theOptions;
 
-  std::map<int, std::string> retval;
   auto it = theIds.cbegin();
   while (it != theIds.end())
   {
@@ -340,55 +827,27 @@ std::map<int, std::string> Query::ResolveNameVariants(const QueryOptions& theOpt
  * Helper method that generates country conditions for sql-query
  *
  * \param theQuery the SQL query yo modify
+ * \param theRestrictCountries False if only excluded countries are to be removed
  */
 // ----------------------------------------------------------------------
 
-void Query::AddCountryConditions(const QueryOptions& theOptions, string& theQuery) const
+void Query::AddCountryConditions(const QueryOptions& theOptions,
+                                 string& theQuery,
+                                 bool theRestrictCountries) const
 {
   try
   {
     // Nothing added if % or all is in the list
-    const list<string>& countries = theOptions.GetCountries();
-    if (!countries.empty() && !contains(countries, "%") && !contains(countries, "all"))
-    {
-      // Append to the query
-
-      int n = 1;
-      for (auto it = countries.begin(); it != countries.end(); ++it, ++n)
-      {
-        string country_iso2 = *it;
-        Fmi::ascii_toupper(country_iso2);
-
-        if (n == 1)
-          theQuery += " AND geonames.countries_iso2 IN (";
-        else
-          theQuery += ",";
-        theQuery += conn->quote(country_iso2);
-      }
-
-      theQuery += ")";
-    }
-
-    const list<string>& excluded_countries = theOptions.GetExcludedCountries();
-    if (!excluded_countries.empty() && !contains(countries, "%") && !contains(countries, "all"))
-    {
-      // Append to the query
-
-      int n = 1;
-      for (auto it = excluded_countries.begin(); it != excluded_countries.end(); ++it, ++n)
-      {
-        string country_iso2 = *it;
-        Fmi::ascii_tolower(country_iso2);
+    if (theOptions.GetAllCountries())
+      return;
 
-        if (n == 1)
-          theQuery += " AND geonames.countries_iso2 NOT IN (";
-        else
-          theQuery += ",";
-        theQuery += conn->quote(country_iso2);
-      }
+    const auto& countries = theOptions.GetCountryCodes();
+    if (theRestrictCountries && !countries.empty())
+      theQuery += " AND geonames.countries_iso2 IN (" + quote(countries) + ")";
 
-      theQuery += ")";
-    }
+    const auto& excluded_countries = theOptions.GetExcludedCountryCodes();
+    if (!excluded_countries.empty())
+      theQuery += " AND geonames.countries_iso2 NOT IN (" + quote(excluded_countries) + ")";
   }
   catch (...)
   {
@@ -408,11 +867,11 @@ void Query::AddFeatureConditions(const QueryOptions& theOptions, string& theQuer
   {
     // Nothing added if % or all is in the list
 
-    const list<string>& features = theOptions.GetFeatures();
-
-    if (features.empty() || contains(features, "%") || contains(features, "all"))
+    if (theOptions.GetAllFeatures())
       return;
 
+    const list<string>& features = theOptions.GetFeatures();
+
     // Append to the query
 
     int n = 1;
@@ -443,11 +902,11 @@ void Query::AddKeywordConditions(const QueryOptions& theOptions, string& theQuer
 {
   try
   {
-    const list<string>& keywords = theOptions.GetKeywords();
-
-    if (keywords.empty() || contains(keywords, "%") || contains(keywords, "all"))
+    if (theOptions.GetAllKeywords())
       return;
 
+    const list<string>& keywords = theOptions.GetKeywords();
+
     // Append to the query
 
     int n = 1;
@@ -476,6 +935,73 @@ void Query::AddKeywordConditions(const QueryOptions& theOptions, string& theQuer
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Resolve area qualifiers of a name search into SQL conditions
+ *
+ * Each area may be the name of a country, a municipality or an
+ * administrative area in any language, and the place must be in all
+ * of them.
+ *
+ * \param theAreas The qualifiers, for example {"Helsinki", "Finland"}
+ * \return The conditions, or nothing if some area is unknown
+ */
+// ----------------------------------------------------------------------
+
+std::optional<std::string> Query::ResolveAreaConditions(const vector<string>& theAreas)
+{
+  try
+  {
+    std::string conditions;
+
+    for (const auto& area : theAreas)
+    {
+      map<SQLQueryParameterId, std::any> params;
+      params[eArea] = area;
+
+      std::set<std::string> countries;
+      std::set<int> municipalities;
+      std::set<std::string> admin_codes;
+
+      pqxx::result res = conn->executeNonTransaction(constructSQLStatement(eResolveArea, params));
+      for (const auto& row : res)
+      {
+        if (row[0].is_null() || row[1].is_null())
+          continue;
+        const auto type = row[0].as<string>();
+        if (type == "country")
+          countries.insert(row[1].as<string>());
+        else if (type == "municipality")
+          municipalities.insert(row[1].as<int>());
+        else
+          admin_codes.insert(row[1].as<string>());
+      }
+
+      if (countries.empty() && municipalities.empty() && admin_codes.empty())
+        return std::nullopt;
+
+      std::vector<std::string> alternatives;
+      if (!countries.empty())
+        alternatives.push_back(selectByValueCond("geonames.countries_iso2", countries));
+      if (!municipalities.empty())
+        alternatives.push_back(selectByValueCond("geonames.municipalities_id", municipalities));
+      if (!admin_codes.empty())
+        alternatives.push_back(
+            selectByValueCond("(geonames.countries_iso2||'.'||geonames.admin1)", admin_codes));
+
+      conditions += " AND (";
+      conditions += boost::algorithm::join(alternatives, " OR ");
+      conditions += ")";
+    }
+
+    return conditions;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 /*!
  * Public method for fetching locations by name
@@ -489,116 +1015,279 @@ Query::return_type Query::FetchByName(const QueryOptions& theOptions, const stri
 {
   try
   {
-    map<SQLQueryParameterId, std::any> params;
-    QueryOptions opts = theOptions;
-    if (!opts.GetNameType().empty())
-      opts.SetLanguage(opts.GetNameType());
-    params[eQueryOptions] = opts;
-    params[eLocationName] = theName;
-
     SetOptions(theOptions);
 
-    // This allows queries like Helsinki, Finland
+    const auto search = ParseNameSearch(theName);
+    if (!search)
+      return {};  // Unknown area
+
+    auto ret = FetchRankedLocations(theOptions, FetchNameCandidates(theOptions, *search), *search);
+
+    if (ret.empty() && theOptions.GetFuzzySearch())
+      ret = FetchBySimilarName(theOptions, *search);
+
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Split a name search into the search word and its qualifiers
+ *
+ * This allows queries like "Helsinki, Finland" or "Kumpula, Helsinki, Finland".
+ * The qualifiers are resolved to areas so that the database returns only
+ * matching places.
+ *
+ * \return Nothing if a qualifier is not a known area
+ */
+// ----------------------------------------------------------------------
 
+std::optional<Query::NameSearch> Query::ParseNameSearch(const string& theName)
+{
+  try
+  {
     vector<string> qparts;
     if (!theName.empty())
       boost::algorithm::split(qparts, theName, boost::algorithm::is_any_of(","));
-    string searchword = (qparts.empty() ? string("") : qparts[0]);
-
-    params[eSearchWord] = searchword;
-
-    // Set country priorities
 
-    const list<string>& countries = theOptions.GetCountries();
+    NameSearch search;
+    search.searchword = (qparts.empty() ? string("") : qparts[0]);
 
-    std::string country_priorities;
-    if (countries.size() > 1)
+    if (qparts.size() > 1)
     {
-      country_priorities += ", CASE countries_iso2 WHEN ";
-      int n = 1;
-      for (auto it = countries.begin(); it != countries.end(); ++it, ++n)
+      vector<string> areas;
+      for (std::size_t i = 1; i < qparts.size(); i++)
       {
-        if (n == 1)
-        {
-          country_priorities += conn->quote(*it);
-          country_priorities += " THEN 1 ";
-        }
-        else
-        {
-          country_priorities += " WHEN ";
-          country_priorities += conn->quote(*it);
-          country_priorities += " THEN ";
-          country_priorities += Fmi::to_string(n);
-        }
+        string area = boost::algorithm::trim_copy(qparts[i]);
+        if (!area.empty())
+          areas.push_back(area);
       }
-      if (n > 1)
-        country_priorities += " ELSE 1000 END as country_priority ";
+
+      auto conditions = ResolveAreaConditions(areas);
+      if (!conditions)
+        return std::nullopt;
+      search.area_conditions = *conditions;
+    }
+
+    return search;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Fetch the candidates of a name search
+ *
+ * Only the columns needed for ranking are fetched. If requested, the
+ * matching name is returned too, in which case a place is listed once
+ * for each of its matching names.
+ */
+// ----------------------------------------------------------------------
+
+std::vector<Query::NameCandidate> Query::FetchNameCandidates(const QueryOptions& theOptions,
+                                                             const NameSearch& theSearch,
+                                                             bool theMatchedNames)
+{
+  try
+  {
+    map<SQLQueryParameterId, std::any> params;
+    params[eQueryOptions] = name_search_options(theOptions);
+    params[eSearchWord] = theSearch.searchword;
+    params[eAreaConditions] = theSearch.area_conditions;
+    params[eMatchedNames] = theMatchedNames;
+
+    // Full country search: places in the listed countries are marked so that the
+    // others can be discarded in the same statement if there are any
+
+    std::string country_fallback;
+    if (theOptions.GetFullCountrySearch() && !theOptions.GetCountryCodes().empty() &&
+        !theOptions.GetAllCountries())
+    {
+      country_fallback = ", CASE WHEN " +
+                         selectByValueCond("countries_iso2", theOptions.GetCountryCodes()) +
+                         " THEN 0 ELSE 1 END AS country_fallback ";
     }
-    params[eCountryPriorities] = country_priorities;
+    params[eCountryFallback] = country_fallback;
 
-    // Set feature priorities
+    pqxx::result res = conn->executeNonTransaction(constructSQLStatement(eFetchByName, params));
 
-    const list<string>& features = theOptions.GetFeatures();
+    std::vector<NameCandidate> candidates;
+    candidates.reserve(res.size());
+    for (const auto& row : res)
+    {
+      NameCandidate candidate;
+      candidate.id = row["id"].as<int>();
+      auto& rank = candidate.rank;
+      if (!row["geonames_priority"].is_null())
+        rank.priority = row["geonames_priority"].as<int>();
+      if (!row["population"].is_null())
+        rank.population = row["population"].as<unsigned int>();
+      if (!row["iso2"].is_null())
+        rank.country_priority = theOptions.GetCountryPriority(row["iso2"].c_str());
+      if (!row["features_code"].is_null())
+        rank.feature_priority = theOptions.GetFeaturePriority(row["features_code"].c_str());
+      if (!row["name"].is_null())
+        rank.name = row["name"].as<std::string>();
+      if (theMatchedNames && !row["matched"].is_null())
+        candidate.matched_name = row["matched"].as<std::string>();
+      candidates.push_back(std::move(candidate));
+    }
+    return candidates;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    std::string feature_priorities;
-    if (features.size() > 1)
+// ----------------------------------------------------------------------
+/*!
+ * \brief Rank the candidates of a name search and fetch the best ones
+ *
+ * Candidates listed several times are ranked once.
+ */
+// ----------------------------------------------------------------------
+
+Query::return_type Query::FetchRankedLocations(const QueryOptions& theOptions,
+                                               const std::vector<NameCandidate>& theCandidates,
+                                               const NameSearch& theSearch)
+{
+  try
+  {
+    std::vector<int> ids;
+    std::vector<Ranking::Candidate> candidates;
+    ids.reserve(theCandidates.size());
+    candidates.reserve(theCandidates.size());
+
+    std::unordered_set<int> seen;
+    for (const auto& candidate : theCandidates)
     {
-      feature_priorities += ", CASE features_code WHEN ";
-      int n = 1;
-      for (auto it = features.begin(); it != features.end(); ++it, ++n)
+      if (seen.insert(candidate.id).second)
       {
-        if (n == 1)
-        {
-          feature_priorities += conn->quote(*it);
-          feature_priorities += " THEN 1 ";
-        }
-        else
-        {
-          feature_priorities += " WHEN ";
-          feature_priorities += conn->quote(*it);
-          feature_priorities += " THEN ";
-          feature_priorities += Fmi::to_string(n);
-        }
+        ids.push_back(candidate.id);
+        candidates.push_back(candidate.rank);
       }
-      if (n > 1)
-        feature_priorities += " ELSE 1000 END as feature_priority ";
     }
-    params[eFeaturePriorities] = feature_priorities;
 
-    string sqlStmt = constructSQLStatement(eFetchByName, params);
+    const auto order = ranking.order(candidates,
+                                     theOptions.GetResultLimit(),
+                                     Ranking::collation_locale(theOptions.GetCollation()));
+    if (order.empty())
+      return {};
 
-    pqxx::result res = conn->executeNonTransaction(sqlStmt);
+    std::vector<int> best;
+    best.reserve(order.size());
+    for (const auto i : order)
+      best.push_back(ids[i]);
 
-    // Create result list
-    return_type locations;
-    if (qparts.size() == 2)
-      locations = build_locations(theOptions, res, searchword, qparts[1]);
-    else
-      locations = build_locations(theOptions, res, searchword);
+    map<SQLQueryParameterId, std::any> params;
+    params[eQueryOptions] = theOptions;
+    params[eGeonameIds] = best;
+    pqxx::result res = conn->executeNonTransaction(constructSQLStatement(eFetchByIds, params));
 
-    if (!locations.empty())
-      return locations;
+    return build_locations(theOptions, res, theSearch.searchword);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    // Prevent endless recursion
+// ----------------------------------------------------------------------
+/*!
+ * \brief Key used for matching a name to the search word in memory
+ *
+ * The key is folded the same way as in the SQL conditions of eFetchByName.
+ */
+// ----------------------------------------------------------------------
 
-    if (recursive_query)
-      return locations;
+std::string Query::NameSearchKey(const QueryOptions& theOptions, const std::string& theName)
+{
+  try
+  {
+    if (theOptions.GetDiacriticInsensitiveSearch())
+      return name_normalizer.normalize(theName);
+    return boost::locale::to_lower(theName, default_locale);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    if (theOptions.GetFullCountrySearch())
-    {
-      // Search all countries
+// ----------------------------------------------------------------------
+/*!
+ * Fetch locations whose names resemble the search word
+ *
+ * Names are matched by trigram similarity (pg_trgm) so that misspelled
+ * names are found too. A bounded number of the best matching places which
+ * satisfy the options is picked from each trigram index, only those are
+ * ranked further.
+ * The search is aborted if it exceeds the time budget set in the options,
+ * in which case nothing is returned.
+ *
+ * \param theSearch The search word, SQL wildcards are ignored, and area conditions
+ * \return locations Array of SimpleLocation objects
+ */
+// ----------------------------------------------------------------------
 
-      if (debug)
-        cout << "Do full country seach because limited search didn't return results\n";
+Query::return_type Query::FetchBySimilarName(const QueryOptions& theOptions,
+                                             const NameSearch& theSearch)
+{
+  try
+  {
+    string word =
+        boost::algorithm::trim_copy(boost::algorithm::erase_all_copy(theSearch.searchword, "%"));
+    boost::algorithm::erase_all(word, "_");
+    if (word.empty())
+      return {};
+
+    map<SQLQueryParameterId, std::any> params;
+    params[eQueryOptions] = name_search_options(theOptions);
+    params[eSearchWord] = word;
+    params[eAreaConditions] = theSearch.area_conditions;
+
+    const string sqlStmt = constructSQLStatement(eFetchBySimilarName, params);
 
-      QueryOptions newoptions = theOptions;
-      newoptions.SetCountries("%");
-      recursive_query = true;
-      locations = FetchByName(newoptions, theName);
-      recursive_query = false;
+    // The fuzzy search is only a fallback, hence a missing pg_trgm extension
+    // or a timeout just means there are no suggestions
+
+    if (conn->executeNonTransaction("SELECT 1 FROM pg_extension WHERE extname='pg_trgm'").empty())
+      return {};
+
+    const SessionSettings settings(
+        *conn,
+        {{"pg_trgm.similarity_threshold", Fmi::to_string(theOptions.GetFuzzyThreshold())},
+         {"statement_timeout", Fmi::to_string(theOptions.GetFuzzyTimeout())}});
+
+    // The connection does not report the SQLSTATE, hence a timeout is
+    // recognized by the time spent. Other errors are passed on.
+
+    pqxx::result res;
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+      res = conn->executeNonTransaction(sqlStmt);
+    }
+    catch (...)
+    {
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      if (theOptions.GetFuzzyTimeout() == 0 ||
+          elapsed < std::chrono::milliseconds(theOptions.GetFuzzyTimeout()))
+        throw;
+      if (debug)
+        std::cerr << Fmi::Exception::Trace(BCP, "Fuzzy name search timed out").what() << '\n';
+      return {};
     }
 
-    return locations;
+    return build_locations(theOptions, res, "");
   }
   catch (...)
   {
@@ -636,6 +1325,9 @@ Query::return_type Query::FetchByLatLon(const QueryOptions& theOptions,
 /*!
  * Method for fetching locations close to some lon,lat point
  *
+ * In exact radius search mode all locations within the radius are
+ * returned in distance order, subject to the result limit.
+ *
  * \param theLatitude Latitude
  * \param theLongitude Longitude
  * \param theRadius Maximum distance from point in kilometers.
@@ -658,10 +1350,11 @@ Query::return_type Query::FetchByLonLat(const QueryOptions& theOptions,
 
     SetOptions(theOptions);
 
-    string sqlStmt = constructSQLStatement(eFetchByLonLat, params);
+    const bool exact = (theOptions.GetExactRadiusSearch() && theRadius > 0);
+    string sqlStmt = constructSQLStatement(exact ? eFetchByRadius : eFetchByLonLat, params);
     pqxx::result res = conn->executeNonTransaction(sqlStmt);
 
-    auto ret = build_locations(theOptions, res, "", "");
+    auto ret = build_locations(theOptions, res, "");
 
     auto copyret = std::make_shared<Locus::Query::return_type>(ret);
 
@@ -698,7 +1391,7 @@ Query::return_type Query::FetchById(const QueryOptions& theOptions, int theId)
     if (res.empty() && theId >= 10000000)
       return FetchById(theOptions, -theId);
 
-    return build_locations(theOptions, res, "", "");
+    return build_locations(theOptions, res, "");
   }
   catch (...)
   {
@@ -741,7 +1434,7 @@ Query::return_type Query::FetchByKeyword(const QueryOptions& theOptions, const s
 
     res = conn->executeNonTransaction(sqlStmt);
 
-    auto ret = build_locations(options, res, "", "");
+    auto ret = build_locations(options, res, "");
 
     return ret;
   }
@@ -783,11 +1476,13 @@ unsigned int Query::CountKeywordLocations(const QueryOptions& theOptions, const
   }
 }
 
-std::map<int, std::string> Query::getNameVariants(const QueryOptions& theOptions,
-                                                  const pqxx::result& theR,
-                                                  const string& theSearchWord)
+Query::IdNames Query::getNameVariants(const QueryOptions& theOptions,
+                                     const pqxx::result& theR,
+                                     const string& theSearchWord,
+                                     std::pmr::memory_resource* theArena)
 {
-  std::map<int, std::string> name_variants;
+  IdNames name_variants(theArena);
+  name_variants.reserve(theR.size());
   std::vector<int> variant_resolve_postponed;
 
   // Does the result have a field for overriding names?
@@ -843,7 +1538,7 @@ std::map<int, std::string> Query::getNameVariants(const QueryOptions& theOptions
     }
 
     if (!name.empty())
-      name_variants[id] = name;  // Store current name for later use
+      name_variants.add(id, name);  // Store current name for later use
   }
 
   // Resolve postponed name variants
@@ -857,28 +1552,46 @@ std::map<int, std::string> Query::getNameVariants(const QueryOptions& theOptions
       const auto& id = item.first;
       const auto& name = item.second;
 
-      // If name is empty or already present in result map then skip it
-      if (!name.empty() && !name_variants.count(id))
-        name_variants[id] = name;
+      // If name is empty skip it, names found above take precedence
+      if (!name.empty())
+        name_variants.add(id, name);
     }
   }
 
+  name_variants.sort(IdNames::Duplicates::KeepFirst);
   return name_variants;
 }
 
-std::vector<std::string> Query::getLanguageCodes(const std::string& language)
+// Quoted codes of the language for IN conditions. The codes of known languages are
+// precomputed, an unknown language is quoted itself into the given buffer.
+const std::string& Query::getLanguageCodeList(const std::string& language,
+                                              std::string& unknown) const
+{
+  const auto* codes = iso639->find_codes(language);
+  if (codes)
+    return codes->sql_list;
+  unknown = conn->quote(language);  // If no codes found, use the language itself
+  return unknown;
+}
+
+// Condition on a language column such as "='fi'" or " in ('fin', 'fi') ", see
+// getLanguageCodeList
+const std::string& Query::getLanguageCodeCondition(const std::string& language,
+                                                   std::string& unknown) const
 {
-  std::vector<std::string> codes = get_iso639_table()->get_codes(language);
-  if (codes.empty())
-    codes.push_back(language);  // If no codes found, use the language itself
-  return codes;
+  const auto* codes = iso639->find_codes(language);
+  if (codes)
+    return codes->sql_condition;
+  unknown = "=" + conn->quote(language);
+  return unknown;
 }
 
-std::map<std::string, std::string> Query::getFeatures(const QueryOptions& /* theOptions */,
-                                                      const pqxx::result& theR)
+Query::CodeNames Query::getFeatures(const QueryOptions& /* theOptions */,
+                                    const pqxx::result& theR,
+                                    std::pmr::memory_resource* theArena)
 {
-  std::map<std::string, std::string> features;
-  std::set<std::string> feature_codes = get_unique_values<string>(theR, "features_code");
+  CodeNames features(theArena);
+  const auto feature_codes = get_unique_values<string>(theR, "features_code");
   if (feature_codes.empty())
     return features;  // No features to process
 
@@ -889,18 +1602,16 @@ std::map<std::string, std::string> Query::getFeatures(const QueryOptions& /* the
   {
     if (row.size() < 2)
       continue;  // Skip rows that do not have the expected columns
-    auto code = row[0].as<std::string>();
-    auto shortdesc = row[1].as<std::string>();
-    if (!shortdesc.empty())
-    {
-      features[code] = shortdesc;
-    }
+    if (!row[1].is_null() && row[1].size() > 0)
+      features.add(std::string_view(row[0].c_str()), row[1].c_str());
   }
+  features.sort(CodeNames::Duplicates::KeepLast);
   return features;
 }
 
-std::map<std::string, std::string> Query::getCountryNames(const QueryOptions& theOptions,
-                                                          const pqxx::result& theR)
+Query::CodeNames Query::getCountryNames(const QueryOptions& theOptions,
+                                        const pqxx::result& theR,
+                                        std::pmr::memory_resource* theArena)
 try
 {
   constexpr const char* sql1 =
@@ -923,52 +1634,49 @@ try
 
   constexpr const char* sql2 = "SELECT iso2, name FROM countries WHERE iso2 IN ({:s})";
 
-  std::map<std::string, std::string> country_names;
-  std::set<std::string> countries = get_unique_values<string>(theR, "iso2");
+  CodeNames country_names(theArena);
+  const auto countries = get_unique_values<string>(theR, "iso2");
   if (countries.empty())
     return country_names;  // No countries to process
 
-  const std::vector<std::string> language_codes = getLanguageCodes(theOptions.GetLanguage());
+  std::string unknown_language;
+  const std::string& language_codes =
+      getLanguageCodeList(theOptions.GetLanguage(), unknown_language);
 
-  const std::string sqlStmt1 = fmt::format(sql1, quote(countries), quote(language_codes));
+  const std::string sqlStmt1 = fmt::format(sql1, quote(countries), language_codes);
   pqxx::result res = conn->executeNonTransaction(sqlStmt1);
   for (const auto& row : res)
   {
     if (row.size() < 2)
       continue;  // Skip rows that do not have the expected columns
-    auto iso2 = row[0].as<std::string>();
-    auto name = row[1].as<std::string>();
-    if (!name.empty())
-    {
-      // If name is already present, keep the shorter one (result is already ordered by length)
-      auto it = country_names.find(iso2);
-      if (it == country_names.end())
-      {
-        country_names[iso2] = name;
-        countries.erase(iso2);  // Do not need to perform another query for this country
-      }
-    }
+    // The first name is preferred, the result is ordered by preference and length
+    if (row[1].size() > 0)
+      country_names.add(std::string_view(row[0].c_str()), row[1].c_str());
   }
+  country_names.sort(CodeNames::Duplicates::KeepFirst);
 
-  if (not countries.empty())
+  // No need for another query for the countries found above
+  std::vector<std::string> missing;
+  for (const auto& iso2 : countries)
+    if (!country_names.contains(iso2))
+      missing.push_back(iso2);
+
+  if (not missing.empty())
   {
     // If there are still countries left, query the countries table
     // to get their names. This is needed for countries that do not
     // have an entry in the geonames table.
-    const std::string sqlStmt2 = fmt::format(sql2, quote(countries));
+    const std::string sqlStmt2 = fmt::format(sql2, quote(missing));
     res = conn->executeNonTransaction(sqlStmt2);
     for (const auto& row : res)
     {
       if (row.size() < 1)
         continue;  // Skip rows that do not have the expected columns
-      const auto iso2 = row[0].as<std::string>();
-      const auto name = row[1].as<std::string>();
-      auto it = country_names.find(iso2);
-      if (it == country_names.end() and !name.empty())
-      {
-        country_names[iso2] = iso2;  // Use iso2 as name if no other name found
-      }
+      const std::string_view iso2 = row[0].c_str();
+      if (row[1].size() > 0)
+        country_names.add(iso2, iso2);  // Use iso2 as name if no other name found
     }
+    country_names.sort(CodeNames::Duplicates::KeepFirst);
   }
 
   return country_names;
@@ -979,8 +1687,9 @@ catch (const Fmi::Exception& e)
   throw;
 }
 
-std::map<int, std::string> Query::getMunicipalityNames(const QueryOptions& theOptions,
-                                                       const pqxx::result& theR)
+Query::IdNames Query::getMunicipalityNames(const QueryOptions& theOptions,
+                                          const pqxx::result& theR,
+                                          std::pmr::memory_resource* theArena)
 try
 {
   constexpr const char* sql1 = "SELECT id, name FROM municipalities WHERE id IN ({})";
@@ -994,9 +1703,11 @@ try
       " AND language IN ({})";
 
   const bool is_fi = theOptions.GetLanguage() == "fi";
-  std::map<int, std::string> municipality_names;
-  std::set<int> municipalities = get_unique_values<int>(theR, "municipalities_id");
-  const std::vector<std::string> language_codes = getLanguageCodes(theOptions.GetLanguage());
+  IdNames municipality_names(theArena);
+  const auto municipalities = get_unique_values<int>(theR, "municipalities_id");
+  std::string unknown_language;
+  const std::string& language_codes =
+      getLanguageCodeList(theOptions.GetLanguage(), unknown_language);
 
   for (auto it = municipalities.begin(); it != municipalities.end();)
   {
@@ -1016,16 +1727,8 @@ try
       const int id = row[0].as<int>();
       if (row[1].is_null())
         continue;  // Skip rows with null name
-      auto name = row[1].as<std::string>();
-      if (!name.empty())
-      {
-        // If name is already present, keep the shorter one (result is already ordered by length)
-        auto it = municipality_names.find(id);
-        if (it == municipality_names.end())
-        {
-          municipality_names[id] = name;
-        }
-      }
+      if (row[1].size() > 0)
+        municipality_names.add(id, row[1].c_str());
     }
   }
 
@@ -1041,7 +1744,7 @@ try
       }
 
       const std::string sqlStmt2 =
-          fmt::format(sql2, quote(currMunicipalities), quote(language_codes));
+          fmt::format(sql2, quote(currMunicipalities), language_codes);
       const auto res = conn->executeNonTransaction(sqlStmt2);
       for (const auto& row : res)
       {
@@ -1050,15 +1753,14 @@ try
         const int id = row[0].as<int>();
         if (row[1].is_null())
           continue;  // Skip rows with null name
-        const auto name = row[1].as<std::string>();
-        if (not name.empty())
-        {
-          municipality_names[id] = name;  // Use id as name if no other name found
-        }
+        if (row[1].size() > 0)
+          municipality_names.add(id, row[1].c_str());
       }
     }
   }
 
+  // Translations found last override the names in the municipalities table
+  municipality_names.sort(IdNames::Duplicates::KeepLast);
   return municipality_names;
 }
 catch (...)
@@ -1076,24 +1778,25 @@ catch (...)
  */
 // ----------------------------------------------------------------------
 
-std::map<std::string, std::string> Query::getAdministrativeNames(
-    const QueryOptions& /* theOptions */, const pqxx::result& theR)
+Query::CodeNames Query::getAdministrativeNames(const QueryOptions& /* theOptions */,
+                                               const pqxx::result& theR,
+                                               std::pmr::memory_resource* theArena)
 {
   constexpr const char* sql = "SELECT code, name FROM admin1codes WHERE code IN ({})";
 
-  std::map<std::string, std::string> admin_names;
+  CodeNames admin_names(theArena);
 
   const std::optional<int> opt_admin1_col = find_column(theR, "admin1");
-  const std::optional<int> opt_country_col = find_column(theR, "country_iso2");
+  const std::optional<int> opt_country_col = find_column(theR, "iso2");
   if (!opt_admin1_col || !opt_country_col)
-    return admin_names;  // No admin1 or country_iso2 columns found
+    return admin_names;  // No admin1 or iso2 columns found
 
   const int admin1_col = *opt_admin1_col;
   const int country_col = *opt_country_col;
 
-  // Collect used admin1 codes. Unfortunately in this case we cannot use
-  // get_unique_values because we need to combine country_iso2 and admin1
-  std::set<std::string> admin_codes;
+  // Collect used admin1 codes of form FI.01. Unfortunately in this case we cannot
+  // use get_unique_values because we need to combine iso2 and admin1
+  std::vector<std::string> admin_codes;
   for (const auto& row : theR)
   {
     if (row[admin1_col].is_null() or row[country_col].is_null())
@@ -1104,9 +1807,10 @@ std::map<std::string, std::string> Query::getAdministrativeNames(
     if (admin1.empty() || country_iso2.empty())
       continue;  // Skip empty admin1 or country_iso2
 
-    const std::string key = country_iso2 + "." + admin1;
-    admin_codes.insert(key);
+    admin_codes.push_back(country_iso2 + "." + admin1);
   }
+  std::sort(admin_codes.begin(), admin_codes.end());
+  admin_codes.erase(std::unique(admin_codes.begin(), admin_codes.end()), admin_codes.end());
 
   // Query the admin1codes table to get the names
   // We need to query the admin1codes table in batches to avoid too large queries (total size could
@@ -1124,31 +1828,30 @@ std::map<std::string, std::string> Query::getAdministrativeNames(
     {
       if (row.size() < 2 || row[0].is_null() || row[1].is_null())
         continue;  // Skip rows that do not have the expected columns or id or their values are NULL
-      const auto code = row[0].as<std::string>();
-      const auto name = row[1].as<std::string>();
-      if (!name.empty())
-      {
-        // Use the admin code as key and name as value
-        admin_names[*it] = name;
-      }
+      // Use the admin code as key and name as value
+      if (row[1].size() > 0)
+        admin_names.add(std::string_view(row[0].c_str()), row[1].c_str());
     }
   }
 
+  admin_names.sort(CodeNames::Duplicates::KeepLast);
   return admin_names;
 }
 
-std::map<int, int> Query::getFmisids(const QueryOptions& /* theOptions */, const pqxx::result& theR)
+FlatMap<int, int> Query::getFmisids(const QueryOptions& /* theOptions */,
+                                    const pqxx::result& theR,
+                                    std::pmr::memory_resource* theArena)
 try
 {
   constexpr const char* sql =
       "SELECT geonames_id, name FROM alternate_geonames "
       "WHERE language='fmisid' AND geonames_id IN ({})";
 
-  const std::set<std::string> ids = get_unique_values<string>(theR, "id");
-  std::map<int, int> fmisids;
+  const auto ids = get_unique_values<int>(theR, "id");
+  FlatMap<int, int> fmisids(theArena);
   for (auto it = ids.begin(); it != ids.end();)
   {
-    std::vector<std::string> currIds;
+    std::vector<int> currIds;
     for (; it != ids.end() and currIds.size() < 1000;)
     {
       currIds.push_back(*it++);
@@ -1167,10 +1870,11 @@ try
       const auto& field = row[1];
       const int fmisid = field.as<int>();
 
-      fmisids[id] = fmisid;
+      fmisids.add(id, fmisid);
     }
   }
 
+  fmisids.sort(FlatMap<int, int>::Duplicates::KeepLast);
   return fmisids;
 }
 catch (...)
@@ -1180,104 +1884,417 @@ catch (...)
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Build a list of locations from query result
+ * Resolve the names of places, countries and municipalities of the result set
+ * in all the additional languages of the options.
  *
- * Note: This implementation differs from the PHP version in that
- *       we implement a cache for storing query results which are
- *       likely to be repeated for example in keyword searches.
+ * Each kind of name is fetched with one statement for all the languages and
+ * the rows are divided by their language code. The names are chosen as in
+ * getNameVariants, getCountryNames and getMunicipalityNames.
+ *
+ * \param theOptions Query options
+ * \param theR Result set
+ * \return the names of each language in the order of QueryOptions::GetTranslations
  */
 // ----------------------------------------------------------------------
 
-Query::return_type Query::build_locations(const QueryOptions& theOptions,
-                                          const pqxx::result& theR,
-                                          const string& theSearchWord,
-                                          const string& theArea /* = ""*/)
+std::vector<Query::Translations> Query::getTranslations(const QueryOptions& theOptions,
+                                                        const pqxx::result& theR,
+                                                        std::pmr::memory_resource* theArena)
 {
   try
   {
-    return_type locations;
-
-    if (theR.empty())
-      return locations;
+    constexpr const char* names_sql =
+        "SELECT geonames_id, name, language FROM alternate_geonames"
+        " WHERE geonames_id IN ({}) AND language IN ({})"
+        " AND historic=false AND colloquial=false"
+        " ORDER BY priority ASC, preferred DESC, length(name) ASC, name ASC";
+
+    constexpr const char* countries_sql1 =
+        "SELECT"
+        " geonames.countries_iso2 AS iso2,"
+        " alternate_geonames.name AS name,"
+        " alternate_geonames.language AS language "
+        "FROM"
+        " geonames,"
+        " alternate_geonames "
+        "WHERE"
+        " geonames.features_code='PCLI'"
+        " AND geonames.countries_iso2 IN ({})"
+        " AND geonames.id=alternate_geonames.geonames_id"
+        " AND alternate_geonames.language IN ({}) "
+        "ORDER BY"
+        " preferred DESC,"
+        " alternate_geonames.priority ASC,"
+        " length(alternate_geonames.name) ASC";
+
+    constexpr const char* countries_sql2 = "SELECT iso2, name FROM countries WHERE iso2 IN ({})";
+
+    constexpr const char* municipalities_sql1 =
+        "SELECT id, name FROM municipalities WHERE id IN ({})";
+
+    constexpr const char* municipalities_sql2 =
+        "SELECT municipalities_id, name, language FROM alternate_municipalities"
+        " WHERE municipalities_id IN ({}) AND language IN ({})";
+
+    constexpr std::size_t max_ids = 1000;  // Limit the number of ids to prevent too large queries
+
+    std::vector<Translations> translations;
+    for (const auto& language : theOptions.GetTranslations())
+      translations.push_back(
+          Translations{language, IdNames(theArena), CodeNames(theArena), IdNames(theArena)});
+
+    if (translations.empty() || theR.empty())
+      return translations;
+
+    // The translations using each language code of the alternate name tables
+
+    std::map<std::string, std::vector<std::size_t>, std::less<>> languages_by_code;
+    std::vector<const NameVariantTable::mapped_type*> preloaded(translations.size(), nullptr);
+
+    for (std::size_t i = 0; i < translations.size(); i++)
+    {
+      string language = translations[i].language;
+      Fmi::ascii_tolower(language);
 
-    // Caches subquery results
+      const auto cached = preferred_names->find(language);
+      if (cached != preferred_names->end())
+        preloaded[i] = &cached->second;
 
-    const std::map<int, std::string> name_variants =
-        getNameVariants(theOptions, theR, theSearchWord);
-    const std::map<std::string, std::string> country_cache = getCountryNames(theOptions, theR);
-    const std::map<int, std::string> municipality_cache = getMunicipalityNames(theOptions, theR);
-    const std::map<std::string, std::string> admin_cache = getAdministrativeNames(theOptions, theR);
-    const std::map<int, int> fmisids = getFmisids(theOptions, theR);
-    const map<string, string> feature_cache = getFeatures(theOptions, theR);
+      const auto* codes = iso639->find_codes(language);
+      if (!codes)
+        languages_by_code[language].push_back(i);
+      else
+        for (const auto& code : codes->codes)
+          languages_by_code[code].push_back(i);
+    }
 
-    // Process one location at a time
+    // Quoted codes of the translations accepted by the filter
+    const auto code_list = [&](const auto& theFilter)
+    {
+      std::vector<std::string> codes;
+      for (const auto& item : languages_by_code)
+        if (std::any_of(item.second.begin(), item.second.end(), theFilter))
+          codes.push_back(item.first);
+      return quote(codes);
+    };
 
-    for (pqxx::result::const_iterator row = theR.begin(); row != theR.end(); ++row)
+    // Call the function for each translation of the language code accepted by the filter
+    const auto for_translations =
+        [&](std::string_view theCode, const auto& theFilter, const auto& theFunction)
     {
-      // Do not handle locations without timezones. This is just a safety check,
-      // NULL timezones should be removed already in the SQL query, otherwise
-      // you might get zero results if the result count limit is 1.
+      const auto pos = languages_by_code.find(theCode);
+      if (pos != languages_by_code.end())
+        for (const auto i : pos->second)
+          if (theFilter(i))
+            theFunction(translations[i]);
+    };
 
+    // Place names, overrides and preloaded names are used as in getNameVariants
+
+    const auto override_col = find_column(theR, "override_name");
+    std::vector<int> ids;
+    ids.reserve(theR.size());
+    for (const auto& row : theR)
+    {
       if (row["timezone"].is_null())
         continue;
 
       const int id = row["id"].as<int>();
-      std::string name = (!row["name"].is_null() ? row["name"].as<string>() : "NULL");
+      if (override_col)
+      {
+        const auto& override = row[*override_col];
+        const std::string_view altname = (!override.is_null() ? override.c_str() : "NULL");
+        if (!altname.empty() && altname != "NULL")
+        {
+          for (auto& translation : translations)
+            translation.names.add(id, altname);
+          continue;
+        }
+      }
+      ids.push_back(id);
+    }
+
+    const auto not_preloaded = [&](std::size_t i) { return preloaded[i] == nullptr; };
 
-      // Check whether name variant should be used
-      auto it1 = name_variants.find(id);
-      if (it1 != name_variants.end())
-        name = it1->second;
+    for (std::size_t i = 0; i < translations.size(); i++)
+    {
+      if (preloaded[i])
+      {
+        for (const int id : ids)
+        {
+          const auto* name = preloaded[i]->find(id);
+          if (name)
+            translations[i].names.add(id, *name);
+        }
+      }
+    }
 
-      if ((!row["ansiname"].is_null()) && (theOptions.GetCharset() != "utf8"))
-        name = from_utf(name, row["ansiname"].as<string>(), theOptions.GetCharset());
+    if (std::any_of(preloaded.begin(), preloaded.end(), [](const auto* p) { return !p; }))
+    {
+      const std::string codes = code_list(not_preloaded);
+      for (auto it = ids.begin(); it != ids.end();)
+      {
+        std::vector<int> curr_ids;
+        for (; it != ids.end() && curr_ids.size() < max_ids; ++it)
+          curr_ids.push_back(*it);
 
-      // Elevation
+        pqxx::result res =
+            conn->executeNonTransaction(fmt::format(names_sql, quote(curr_ids), codes));
+        for (const auto& row : res)
+        {
+          const std::string_view name = row[1].c_str();
+          if (name.empty())
+            continue;
+          const int id = row[0].as<int>();
+          for_translations(row[2].c_str(),
+                           not_preloaded,
+                           [&](Translations& theTranslation)
+                           { theTranslation.names.add(id, name); });
+        }
+      }
+    }
 
-      int elevation = 0;
+    for (auto& translation : translations)
+      translation.names.sort(IdNames::Duplicates::KeepFirst);
 
-      if (!row["elevation"].is_null() && (row["elevation"].as<int>() != 0))
-        elevation = row["elevation"].as<int>();
-      else if (!row["dem"].is_null())
-        elevation = row["dem"].as<int>();
+    // Country names as in getCountryNames
 
-      // Country and description
+    const auto all = [](std::size_t /* i */) { return true; };
 
-      string country;
-      string iso2;
-      if (!row["iso2"].is_null())
+    const auto countries = get_unique_values<string>(theR, "iso2");
+    if (!countries.empty())
+    {
+      pqxx::result res = conn->executeNonTransaction(
+          fmt::format(countries_sql1, quote(countries), code_list(all)));
+      for (const auto& row : res)
       {
-        iso2 = row["iso2"].as<string>();
-        const auto pos = country_cache.find(iso2);
-        if (pos != country_cache.end())
-          country = pos->second;
+        const std::string_view name = row[1].c_str();
+        if (name.empty())
+          continue;
+        const std::string_view iso2 = row[0].c_str();
+        for_translations(row[2].c_str(),
+                         all,
+                         [&](Translations& theTranslation)
+                         { theTranslation.countries.add(iso2, name); });
       }
 
-      // Feature code and description
-
-      string description;
-      string features_code;
-      if (!row["features_code"].is_null())
+      std::set<std::string> missing;
+      for (auto& translation : translations)
       {
-        features_code = row["features_code"].as<string>();
-        const auto pos = feature_cache.find(features_code);
-        if (pos != feature_cache.end())
-          description = pos->second;
+        translation.countries.sort(CodeNames::Duplicates::KeepFirst);
+        for (const auto& iso2 : countries)
+          if (!translation.countries.contains(iso2))
+            missing.insert(iso2);
       }
 
-      // Administrative areas
-
-      string administrative;
-      if (row["municipalities_id"].is_null())
+      if (!missing.empty())
+      {
+        res = conn->executeNonTransaction(fmt::format(countries_sql2, quote(missing)));
+        for (const auto& row : res)
+        {
+          const std::string_view iso2 = row[0].c_str();
+          if (row[1].size() == 0)
+            continue;
+          for (auto& translation : translations)
+            if (!translation.countries.contains(iso2))
+              translation.countries.add(iso2, iso2);  // Use iso2 as name if no other name found
+        }
+        for (auto& translation : translations)
+          translation.countries.sort(CodeNames::Duplicates::KeepFirst);
+      }
+    }
+
+    // Municipality names as in getMunicipalityNames, translations override
+    // the names in the municipalities table
+
+    const auto not_fi = [&](std::size_t i) { return translations[i].language != "fi"; };
+    const bool translated = std::any_of(translations.begin(),
+                                        translations.end(),
+                                        [](const Translations& t) { return t.language != "fi"; });
+
+    const auto municipalities = get_unique_values<int>(theR, "municipalities_id");
+    for (auto it = municipalities.begin(); it != municipalities.end();)
+    {
+      std::vector<int> curr_ids;
+      for (; it != municipalities.end() && curr_ids.size() < max_ids; ++it)
+        curr_ids.push_back(*it);
+
+      pqxx::result res =
+          conn->executeNonTransaction(fmt::format(municipalities_sql1, quote(curr_ids)));
+      for (const auto& row : res)
+      {
+        if (row[1].is_null() || row[1].size() == 0)
+          continue;
+        const int id = row[0].as<int>();
+        for (auto& translation : translations)
+          translation.municipalities.add(id, row[1].c_str());
+      }
+    }
+
+    if (translated)
+    {
+      const std::string codes = code_list(not_fi);
+      for (auto it = municipalities.begin(); it != municipalities.end();)
+      {
+        std::vector<int> curr_ids;
+        for (; it != municipalities.end() && curr_ids.size() < max_ids; ++it)
+          curr_ids.push_back(*it);
+
+        pqxx::result res =
+            conn->executeNonTransaction(fmt::format(municipalities_sql2, quote(curr_ids), codes));
+        for (const auto& row : res)
+        {
+          if (row[1].is_null() || row[1].size() == 0)
+            continue;
+          const int id = row[0].as<int>();
+          const std::string_view name = row[1].c_str();
+          for_translations(row[2].c_str(),
+                           not_fi,
+                           [&](Translations& theTranslation)
+                           { theTranslation.municipalities.add(id, name); });
+        }
+      }
+    }
+
+    for (auto& translation : translations)
+      translation.municipalities.sort(IdNames::Duplicates::KeepLast);
+
+    return translations;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a list of locations from query result
+ *
+ * Note: This implementation differs from the PHP version in that
+ *       we implement a cache for storing query results which are
+ *       likely to be repeated for example in keyword searches.
+ */
+// ----------------------------------------------------------------------
+
+Query::return_type Query::build_locations(const QueryOptions& theOptions,
+                                          const pqxx::result& theR,
+                                          const string& theSearchWord)
+{
+  try
+  {
+    return_type locations;
+
+    if (theR.empty())
+      return locations;
+
+    const std::size_t limit = theOptions.GetResultLimit();
+    locations.reserve(limit > 0 ? std::min<std::size_t>(limit, theR.size()) : theR.size());
+
+    // Caches subquery results. They are needed only during this call, hence
+    // they are allocated from an arena which is released all at once. Typical
+    // results fit in the initial buffer, bigger ones grow it geometrically.
+
+    std::array<std::byte, initial_arena_bytes> arena_buffer;
+    std::pmr::monotonic_buffer_resource arena(arena_buffer.data(), arena_buffer.size());
+
+    const IdNames name_variants = getNameVariants(theOptions, theR, theSearchWord, &arena);
+    const CodeNames country_cache = getCountryNames(theOptions, theR, &arena);
+    const IdNames municipality_cache = getMunicipalityNames(theOptions, theR, &arena);
+    const CodeNames admin_cache = getAdministrativeNames(theOptions, theR, &arena);
+    const FlatMap<int, int> fmisids = getFmisids(theOptions, theR, &arena);
+    const CodeNames feature_cache = getFeatures(theOptions, theR, &arena);
+
+    // The same for the additional languages. Names in autocomplete mode are
+    // resolved using the search word, which is in the primary language only
+
+    const std::vector<Translations> translation_caches =
+        getTranslations(theOptions, theR, &arena);
+
+    const LocationColumns col(theR);
+
+    // Process one location at a time
+
+    for (const auto& row : theR)
+    {
+      // Do not handle locations without timezones. This is just a safety check,
+      // NULL timezones should be removed already in the SQL query, otherwise
+      // you might get zero results if the result count limit is 1.
+
+      if (row[col.timezone].is_null())
+        continue;
+
+      const int id = parse_number<int>(row[col.id]);
+      const std::string original_name =
+          (!row[col.name].is_null() ? row[col.name].c_str() : "NULL");
+
+      // Check whether name variant should be used, and convert to the
+      // requested character set
+      const auto localized_name = [&](const IdNames& theVariants)
+      {
+        std::string name = original_name;
+        auto pos = theVariants.find(id);
+        if (pos != theVariants.end())
+          name = pos->second;
+
+        if ((!row[col.ansiname].is_null()) && (theOptions.GetCharset() != "utf8"))
+          name = from_utf(name, row[col.ansiname].as<string>(), theOptions.GetCharset());
+        return name;
+      };
+
+      std::string name = localized_name(name_variants);
+
+      // Elevation
+
+      int elevation = 0;
+
+      if (!row[col.elevation].is_null())
+        elevation = parse_number<int>(row[col.elevation]);
+      if (elevation == 0 && !row[col.dem].is_null())
+        elevation = parse_number<int>(row[col.dem]);
+
+      // Country and description
+
+      string country;
+      string iso2;
+      if (!row[col.iso2].is_null())
+      {
+        iso2 = row[col.iso2].c_str();
+        const auto pos = country_cache.find(iso2);
+        if (pos != country_cache.end())
+          country = pos->second;
+      }
+
+      // Feature code and description
+
+      string description;
+      string features_code;
+      if (!row[col.features_code].is_null())
+      {
+        features_code = row[col.features_code].c_str();
+        const auto pos = feature_cache.find(features_code);
+        if (pos != feature_cache.end())
+          description = pos->second;
+      }
+
+      // Administrative areas
+
+      string administrative;
+      const bool has_municipality = !row[col.municipalities_id].is_null();
+      const int municipalities_id =
+          (has_municipality ? parse_number<int>(row[col.municipalities_id]) : 0);
+
+      if (!has_municipality)
       {
         // If municipalities_id is NULL, we try to resolve administrative area
-        // from admin1 and iso2 fields
+        // from admin1 and iso2 fields, see getAdministrativeNames
 
-        auto admin1 = row["admin1"].as<string>();
-        if (!admin1.empty())
+        const std::string_view admin1 = row[col.admin1].c_str();
+        if (!admin1.empty() && !iso2.empty())
         {
-          auto localiso2 = row["iso2"].as<string>();
-          string key = admin1 + '|' + localiso2;
+          string key(iso2);
+          key += '.';
+          key += admin1;
           const auto pos = admin_cache.find(key);
           if (pos != admin_cache.end())
             administrative = pos->second;
@@ -1288,42 +2305,54 @@ Query::return_type Query::build_locations(const QueryOptions& theOptions,
         // If municipalities_id is not NULL, we try to resolve administrative area
         // from municipalities_id field
 
-        const int municipalities_id = row["municipalities_id"].as<int>();
         auto pos = municipality_cache.find(municipalities_id);
         if (pos != municipality_cache.end())
           administrative = pos->second;
       }
 
-      // Check if area is correct
-      bool ok = true;
-
-      if (!theArea.empty())
+      // The location is built in place, the strings are no longer needed here
+
+      auto& loc = locations.emplace_back(std::move(name),
+                                         parse_number<float>(row[col.lon]),
+                                         parse_number<float>(row[col.lat]),
+                                         std::move(country),
+                                         std::move(features_code),
+                                         std::move(description),
+                                         row[col.timezone].c_str(),
+                                         std::move(administrative),
+                                         parse_number<unsigned int>(row[col.population]),
+                                         std::move(iso2),
+                                         id,
+                                         elevation);
+
+      const auto fmisid_it = fmisids.find(id);
+      if (fmisid_it != fmisids.end())
+        loc.fmisid = fmisid_it->second;
+
+      if (col.distance && !row[*col.distance].is_null())
+        loc.distance = parse_number<float>(row[*col.distance]) / 1000;
+
+      // Azimuth is NULL when the location is at the query point
+      if (col.bearing && !row[*col.bearing].is_null())
+        loc.bearing = parse_number<float>(row[*col.bearing]);
+
+      for (const auto& cache : translation_caches)
       {
-        string lc_area = boost::locale::to_lower(theArea, default_locale);
-        ok = (lc_area == boost::locale::to_lower(country, default_locale) ||
-              lc_area == boost::locale::to_lower(administrative, default_locale));
-      }
+        auto& translation = loc.translations[cache.language];
+        translation.name = localized_name(cache.names);
 
-      if (ok)
-      {
-        SimpleLocation loc(name,
-                           row["lon"].as<float>(),
-                           row["lat"].as<float>(),
-                           country,
-                           features_code,
-                           description,
-                           row["timezone"].as<string>(),
-                           administrative,
-                           row["population"].as<unsigned int>(),
-                           iso2,
-                           row["id"].as<int>(),
-                           elevation);
-
-        const auto fmisid_it = fmisids.find(id);
-        if (fmisid_it != fmisids.end())
-          loc.fmisid = fmisid_it->second;
-
-        locations.emplace_back(loc);
+        const auto country_pos = cache.countries.find(loc.iso2);
+        if (country_pos != cache.countries.end())
+          translation.country = country_pos->second;
+
+        // Only municipality names are translated
+        translation.admin = loc.admin;
+        if (has_municipality)
+        {
+          const auto pos = cache.municipalities.find(municipalities_id);
+          if (pos != cache.municipalities.end())
+            translation.admin = pos->second;
+        }
       }
 
       // See if locations-sequence is already long enough
@@ -1334,31 +2363,18 @@ Query::return_type Query::build_locations(const QueryOptions& theOptions,
       }
     }
 
-    // Sort exact matchs first if autocompletemode
+    // Sort exact matchs first if autocompletemode. The locations are moved
+    // in place, and the search word without the "%" is folded only once.
 
-    if (theOptions.GetAutoCompleteMode())
+    if (theOptions.GetAutoCompleteMode() && !theSearchWord.empty())
     {
-      vector<SimpleLocation> bestmatches;
-      vector<SimpleLocation> secondarymatches;
-
-      // Remove "%" from searchword
-      string tmp = theSearchWord.substr(0, theSearchWord.size() - 1);
-
-      for (const auto& location : locations)
-      {
-        if (boost::iequals(tmp, location.name))
-          bestmatches.push_back(location);
-        else
-          secondarymatches.push_back(location);
-      }
+      std::string key = theSearchWord.substr(0, theSearchWord.size() - 1);
+      Fmi::ascii_tolower(key);
 
-      locations.clear();
-
-      for (const auto& match : bestmatches)
-        locations.push_back(match);
-
-      for (const auto& match : secondarymatches)
-        locations.push_back(match);
+      std::stable_partition(locations.begin(),
+                            locations.end(),
+                            [&key](const SimpleLocation& theLocation)
+                            { return equals_folded(theLocation.name, key); });
     }
 
     return locations;
@@ -1376,26 +2392,11 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
   {
     std::string sql;
 
-    const auto constructLanguageCodeCondition = [this](const std::string& language) -> std::string
-    {
-      const std::vector<std::string> codes = get_iso639_table()->get_codes(language);
-      if (codes.empty())
-        return "=" + conn->quote(language);
-
-      if (codes.size() == 1)
-        return "=" + conn->quote(codes.at(0));
-
-      std::string result = " in (";
-      for (std::size_t i = 0; i < codes.size(); i++)
-      {
-        if (i)
-          result += ", ";
-
-        result += conn->quote(codes.at(i));
-      }
-      result += ") ";
-      return result;
-    };
+    // The condition is appended to the statement before the next one is made
+    std::string unknown_language;
+    const auto constructLanguageCodeCondition =
+        [&](const std::string& language) -> const std::string&
+    { return getLanguageCodeCondition(language, unknown_language); };
 
     const auto& theOptions = std::any_cast<const QueryOptions&>(theParams.at(eQueryOptions));
 
@@ -1413,7 +2414,8 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
           sql +=
               "SELECT name,length(name) AS l, priority FROM alternate_geonames WHERE geonames_id=";
           sql += Fmi::to_string(theGeonamesId);
-          sql += " AND language" + constructLanguageCodeCondition(language);
+          sql += " AND language";
+          sql += constructLanguageCodeCondition(language);
           sql +=
               " AND historic=false AND colloquial=false ORDER BY priority ASC, preferred DESC, l "
               "ASC, name ASC LIMIT 1";
@@ -1423,7 +2425,8 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
           sql +=
               "SELECT name,length(name) As l, priority FROM alternate_geonames WHERE geonames_id=";
           sql += Fmi::to_string(theGeonamesId);
-          sql += " AND language" + constructLanguageCodeCondition(language);
+          sql += " AND language";
+          sql += constructLanguageCodeCondition(language);
           sql += " AND name LIKE ";
           sql += conn->quote(theSearchWord);
           sql +=
@@ -1441,87 +2444,182 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
         sql +=
             "SELECT geonames_id, name,length(name) AS l, priority FROM alternate_geonames WHERE ";
         sql += selectByValueCond("geonames_id", theGeonamesIds);
-        sql += " AND language" + constructLanguageCodeCondition(language);
+        sql += " AND language";
+        sql += constructLanguageCodeCondition(language);
         sql +=
             " AND historic=false AND colloquial=false ORDER BY priority ASC, preferred DESC, l "
             "ASC, name ASC";
       }
       break;
 
-      case eFetchByName:
+      case eLoadNameVariants:
       {
-        if (theOptions.GetSearchVariants())
-          sql += "(";
+        string language = theOptions.GetLanguage();
+        Fmi::ascii_tolower(language);
 
+        // Same preference order as in eResolveNameVariants
+        sql +=
+            "SELECT DISTINCT ON (geonames_id) geonames_id, name FROM alternate_geonames"
+            " WHERE language" +
+            constructLanguageCodeCondition(language) +
+            " AND historic=false AND colloquial=false AND name<>''";
+        if (theParams.find(eGeonamesId) != theParams.end())
+          sql += " AND " + selectByValueCond("geonames_id",
+                                             std::any_cast<std::vector<int>>(
+                                                 theParams.at(eGeonamesId)));
+        sql += " ORDER BY geonames_id, priority ASC, preferred DESC, length(name) ASC, name ASC";
+        break;
+      }
+      case eResolveArea:
+      {
+        const std::string area = conn->quote(std::any_cast<string>(theParams.at(eArea)));
+
+        sql += fmt::format(
+            "SELECT 'country', iso2 FROM countries WHERE LOWER(name)=LOWER({0}) "
+            "UNION SELECT 'country', geonames.countries_iso2 FROM geonames, alternate_geonames"
+            " WHERE geonames.features_code='PCLI' AND geonames.id=alternate_geonames.geonames_id"
+            " AND LOWER(alternate_geonames.name)=LOWER({0}) "
+            "UNION SELECT 'municipality', id::text FROM municipalities"
+            " WHERE LOWER(name)=LOWER({0}) "
+            "UNION SELECT 'municipality', municipalities_id::text FROM alternate_municipalities"
+            " WHERE LOWER(name)=LOWER({0}) "
+            "UNION SELECT 'admin', code FROM admin1codes WHERE LOWER(name)=LOWER({0})",
+            area);
+        break;
+      }
+      case eFetchByName:
+      {
         auto theSearchWord = std::any_cast<string>(theParams.at(eSearchWord));
-        auto theCountryPriorities = std::any_cast<string>(theParams.at(eCountryPriorities));
-        auto theFeaturePriorities = std::any_cast<string>(theParams.at(eFeaturePriorities));
+        auto theAreaConditions = std::any_cast<string>(theParams.at(eAreaConditions));
+        auto theCountryFallback = std::any_cast<string>(theParams.at(eCountryFallback));
+        const bool fallback = !theCountryFallback.empty();
+        const bool matched = std::any_cast<bool>(theParams.at(eMatchedNames));
 
-        sql +=
-            "SELECT DISTINCT geonames.name AS name,"
-            " geonames.ansiname AS ansiname,"
-            " lat, lon, countries_iso2 AS iso2,"
-            " features_code, timezone, geonames.id as id, geonames.priority as geonames_priority,"
-            " municipalities_id, admin1, population, "
-            " elevation, dem, "
-            " CASE WHEN population>50000 THEN population ELSE 0 END AS population_priority ";
-        sql += theCountryPriorities;
-        sql += ' ';
-        sql += theFeaturePriorities;
-        sql += " FROM geonames WHERE LOWER(geonames.name) LIKE LOWER(";
-        sql += conn->quote(theSearchWord);
-        sql += ')';
+        // In indexed modes the pattern is folded here and no collation is used so
+        // that an expression index with text_pattern_ops can serve prefix searches
 
-        if (conn->collateSupported())
+        const auto nameCondition = [&](const std::string& theColumn) -> std::string
         {
-          sql += " COLLATE ";
-          sql += conn->quote(theOptions.GetCollation());
-        }
+          if (theOptions.GetDiacriticInsensitiveSearch())
+          {
+            return "locus_fold(" + theColumn +
+                   ") LIKE " + conn->quote(name_normalizer.normalize(theSearchWord));
+          }
 
-        // PHP version does not do this, but we cannot tolerate it in brainstorm
-        sql += " AND timezone IS NOT NULL";
+          if (theOptions.GetIndexedNameSearch())
+          {
+            return "LOWER(" + theColumn +
+                   ") LIKE " + conn->quote(boost::locale::to_lower(theSearchWord, default_locale));
+          }
 
-        if (theOptions.GetPopulationMin() > 0)
+          std::string condition =
+              "LOWER(" + theColumn + ") LIKE LOWER(" + conn->quote(theSearchWord) + ")";
+          if (conn->collateSupported())
+          {
+            condition += " COLLATE ";
+            condition += conn->quote(theOptions.GetCollation());
+          }
+          return condition;
+        };
+
+        // Conditions on the place itself, the same in both branches. Every row
+        // dropped later on (NULL timezone) must be excluded here, otherwise such
+        // rows could win the country fallback below and empty the result.
+
+        const auto placeConditions = [&]()
         {
-          sql += " AND population>=";
-          sql += Fmi::to_string(theOptions.GetPopulationMin());
-        }
-        if (theOptions.GetPopulationMax() > 0)
+          // PHP version does not do this, but we cannot tolerate it in brainstorm
+          sql += " AND timezone IS NOT NULL";
+
+          if (theOptions.GetPopulationMin() > 0)
+          {
+            sql += " AND population>=";
+            sql += Fmi::to_string(theOptions.GetPopulationMin());
+          }
+          if (theOptions.GetPopulationMax() > 0)
+          {
+            sql += " AND population<=";
+            sql += Fmi::to_string(theOptions.GetPopulationMax());
+          }
+
+          AddFeatureConditions(theOptions, sql);
+          AddCountryConditions(theOptions, sql, !fallback);
+          AddKeywordConditions(theOptions, sql);
+          sql += theAreaConditions;
+        };
+
+        // When only the best candidates are needed, each branch returns only its
+        // best rows in the default order of Ranking. Rows which tie with the last
+        // one are kept, hence the names, which are collated in the client, never
+        // decide which rows are left out. The bound is not used with a custom
+        // scorer, or when all matched names are needed by an autocomplete session.
+
+        std::string bound;
+        if (!matched && theOptions.GetResultLimit() > 0 && !ranking.has_scorer())
         {
-          sql += " AND population<=";
-          sql += Fmi::to_string(theOptions.GetPopulationMax());
+          bound = ") AS branch ORDER BY ";
+          if (fallback)
+            bound += "country_fallback, ";
+          bound +=
+              "COALESCE(geonames_priority, 0),"
+              " CASE WHEN population>50000 THEN population ELSE 0 END DESC, ";
+          bound += priority_order("iso2", theOptions.GetCountries());
+          bound += ", ";
+          bound += priority_order("features_code", theOptions.GetFeatures());
+          bound += ", COALESCE(population, 0) DESC FETCH FIRST ";
+          bound += Fmi::to_string(theOptions.GetResultLimit());
+          bound += " ROWS WITH TIES";
         }
 
-        AddFeatureConditions(theOptions, sql);
-        AddCountryConditions(theOptions, sql);
-        AddKeywordConditions(theOptions, sql);
+        const auto boundBranch = [&](std::size_t theStart)
+        {
+          if (bound.empty())
+            return;
+          sql.insert(theStart, "SELECT * FROM (");
+          sql += bound;
+        };
+
+        // With a fallback the candidates from all countries are collected first
+        // and those outside the listed countries are used only if there is nothing else.
+        // Note that the fallback makes the statement scan the matches in all countries.
+
+        if (fallback)
+          sql += "WITH candidates AS (";
+
+        if (theOptions.GetSearchVariants())
+          sql += "(";
+
+        // Only the columns needed for ranking the candidates are selected,
+        // the best ones are then fetched with eFetchByIds
+
+        std::size_t branch_start = sql.size();
+        sql +=
+            "SELECT DISTINCT geonames.name AS name, countries_iso2 AS iso2, features_code,"
+            " geonames.id as id, geonames.priority as geonames_priority, population";
+        if (matched)
+          sql += ", geonames.name AS matched";
+        sql += theCountryFallback;
+        sql += " FROM geonames WHERE ";
+        sql += nameCondition("geonames.name");
+        placeConditions();
+        boundBranch(branch_start);
 
         if (theOptions.GetSearchVariants())
         {
           string language = theOptions.GetLanguage();
           Fmi::ascii_tolower(language);
 
+          sql += ") UNION (";
+          branch_start = sql.size();
           sql +=
-              ") UNION (SELECT DISTINCT geonames.name AS name,"
-              " geonames.ansiname AS ansiname, lat, lon,"
-              " countries_iso2 AS iso2, features_code, timezone,"
-              " geonames.id as id, geonames.priority as geonames_priority, municipalities_id,"
-              " admin1, population, "
-              " elevation, dem, "
-              " CASE WHEN population>50000 THEN population ELSE 0 END AS population_priority ";
-          sql += theCountryPriorities;
-          sql += ' ';
-          sql += theFeaturePriorities;
-          sql +=
-              " FROM geonames, alternate_geonames WHERE LOWER(alternate_geonames.name) LIKE LOWER(";
-          sql += conn->quote(theSearchWord);
-          sql += ")";
-
-          if (conn->collateSupported())
-          {
-            sql += " COLLATE ";
-            sql += conn->quote(theOptions.GetCollation());
-          }
+              "SELECT DISTINCT geonames.name AS name, countries_iso2 AS iso2,"
+              " features_code, geonames.id as id, geonames.priority as geonames_priority,"
+              " population";
+          if (matched)
+            sql += ", alternate_geonames.name AS matched";
+          sql += theCountryFallback;
+          sql += " FROM geonames, alternate_geonames WHERE ";
+          sql += nameCondition("alternate_geonames.name");
 
           // FIXME: update this
           sql +=
@@ -1529,39 +2627,119 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
               "LIKE ";
           sql += conn->quote(language);
 
-          if (theOptions.GetPopulationMin() > 0)
-          {
-            sql += " AND population>=";
-            sql += Fmi::to_string(theOptions.GetPopulationMin());
-          }
-          if (theOptions.GetPopulationMax() > 0)
-          {
-            sql += " AND population<=";
-            sql += Fmi::to_string(theOptions.GetPopulationMax());
-          }
           if (theOptions.GetAutoCompleteMode())
           {
             sql += " AND alternate_geonames.language";
             sql += constructLanguageCodeCondition(language);
           }
 
-          AddFeatureConditions(theOptions, sql);
-          AddCountryConditions(theOptions, sql);
-          AddKeywordConditions(theOptions, sql);
+          placeConditions();
+          boundBranch(branch_start);
           sql += ')';
         }
 
-        sql += " ORDER BY geonames_priority, population_priority DESC, ";
-        sql += (theCountryPriorities.empty() ? "" : "country_priority, ");
-        sql += (theFeaturePriorities.empty() ? "" : "feature_priority, ");
-        sql += " population DESC, name";
+        if (fallback)
+        {
+          sql +=
+              ") SELECT * FROM candidates"
+              " WHERE country_fallback=(SELECT min(country_fallback) FROM candidates)";
+        }
+
+        // The candidates are ordered by Ranking in FetchRankedLocations
+        break;
+      }
+      case eFetchByIds:
+      {
+        const auto& theIds = std::any_cast<const std::vector<int>&>(theParams.at(eGeonameIds));
+
+        // The rows are returned in the order of the ids
+
+        std::string idlist;
+        for (const auto id : theIds)
+        {
+          if (!idlist.empty())
+            idlist += ',';
+          idlist += Fmi::to_string(id);
+        }
+
+        sql +=
+            "SELECT geonames.name AS name, geonames.ansiname AS ansiname,"
+            " lat, lon, countries_iso2 AS iso2, features_code, timezone, geonames.id AS id,"
+            " municipalities_id, admin1, population, elevation, dem"
+            " FROM unnest(ARRAY[";
+        sql += idlist;
+        sql +=
+            "]::integer[]) WITH ORDINALITY AS ranked(id, rank), geonames"
+            " WHERE geonames.id=ranked.id ORDER BY ranked.rank";
+        break;
+      }
+      case eFetchBySimilarName:
+      {
+        const auto word = conn->quote(std::any_cast<string>(theParams.at(eSearchWord)));
+        const auto theAreaConditions = std::any_cast<string>(theParams.at(eAreaConditions));
+
+        // Conditions on the place itself. They are applied in each branch so
+        // that the bound below does not fill up with places filtered out later.
 
-        if (conn->collateSupported())
+        std::string conditions = " AND timezone IS NOT NULL";
+        if (theOptions.GetPopulationMin() > 0)
+        {
+          conditions += " AND population>=";
+          conditions += Fmi::to_string(theOptions.GetPopulationMin());
+        }
+        if (theOptions.GetPopulationMax() > 0)
         {
-          sql += " COLLATE ";
-          sql += conn->quote(theOptions.GetCollation());
+          conditions += " AND population<=";
+          conditions += Fmi::to_string(theOptions.GetPopulationMax());
         }
 
+        AddFeatureConditions(theOptions, conditions);
+        AddCountryConditions(theOptions, conditions);
+        AddKeywordConditions(theOptions, conditions);
+        conditions += theAreaConditions;
+
+        // Only a bounded number of best candidates is taken from each trigram
+        // index to keep the cost independent of how common the trigrams are
+
+        sql += fmt::format(
+            "WITH matches AS ("
+            "(SELECT geonames.id AS id, similarity(geonames.name, {0}) AS score FROM geonames"
+            " WHERE geonames.name % {0}{2} ORDER BY score DESC LIMIT {1})",
+            word,
+            fuzzy_candidate_limit,
+            conditions);
+
+        if (theOptions.GetSearchVariants())
+        {
+          string language = theOptions.GetLanguage();
+          Fmi::ascii_tolower(language);
+
+          sql += fmt::format(
+              " UNION ALL (SELECT geonames.id AS id, similarity(alternate_geonames.name, {0})"
+              " AS score FROM alternate_geonames, geonames"
+              " WHERE alternate_geonames.name % {0} AND alternate_geonames.geonames_id=geonames.id"
+              " AND alternate_geonames.language{2} AND alternate_geonames.historic=false{3}"
+              " ORDER BY score DESC LIMIT {1})",
+              word,
+              fuzzy_candidate_limit,
+              constructLanguageCodeCondition(language),
+              conditions);
+        }
+
+        sql +=
+            "), best AS (SELECT id, max(score) AS score FROM matches GROUP BY id) "
+            "SELECT geonames.name AS name, geonames.ansiname AS ansiname,"
+            " lat, lon, countries_iso2 AS iso2, features_code, timezone, geonames.id AS id,"
+            " municipalities_id, admin1, population, elevation, dem, best.score AS similarity"
+            " FROM best, geonames WHERE geonames.id=best.id";
+
+        sql += " ORDER BY similarity DESC, population DESC, id";
+
+        if (theOptions.GetResultLimit() > 0)
+        {
+          sql += " LIMIT ";
+          sql += Fmi::to_string(theOptions.GetResultLimit());
+        }
         break;
       }
       case eFetchByLonLat:
@@ -1580,7 +2758,11 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
         sql += Fmi::to_string(theLongitude);
         sql += ' ';
         sql += Fmi::to_string(theLatitude);
-        sql += ")'), the_geog, true) as distance FROM geonames WHERE ";
+        sql += ")'), the_geog, true) as distance, degrees(ST_Azimuth(ST_GeographyFromText('POINT(";
+        sql += Fmi::to_string(theLongitude);
+        sql += ' ';
+        sql += Fmi::to_string(theLatitude);
+        sql += ")'), the_geog)) as bearing FROM geonames WHERE ";
 
         // PHP version does not do this, but we cannot tolerate it in brainstorm
         sql += " timezone IS NOT NULL";
@@ -1637,6 +2819,60 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
 
         break;
       }
+      case eFetchByRadius:
+      {
+        auto theLongitude = std::any_cast<float>(theParams.at(eLongitude));
+        auto theLatitude = std::any_cast<float>(theParams.at(eLatitude));
+        auto theRadius = std::any_cast<float>(theParams.at(eRadius));
+
+        // The bounding box uses the index on the_geom, the exact distance is then
+        // calculated only for the places in the box
+
+        const BBox box = radius_bbox(theLongitude, theLatitude, theRadius);
+        const std::string point =
+            fmt::format("ST_GeographyFromText('POINT({} {})')", theLongitude, theLatitude);
+
+        sql +=
+            "SELECT geonames.id AS id, geonames.name AS name,"
+            " geonames.ansiname AS ansiname, lat, lon,"
+            " countries_iso2 AS iso2, features_code, timezone,"
+            " population, elevation, dem, municipalities_id,"
+            " admin1, ST_Distance(";
+        sql += point;
+        sql += ", the_geog, true) AS distance, degrees(ST_Azimuth(";
+        sql += point;
+        sql += ", the_geog)) AS bearing FROM geonames WHERE ";
+        sql += fmt::format("the_geom && ST_MakeEnvelope({},{},{},{},4326)",
+                           box.xmin,
+                           box.ymin,
+                           box.xmax,
+                           box.ymax);
+        sql += fmt::format(" AND ST_DWithin({}, the_geog, {}, true)", point, theRadius * 1000);
+        sql += " AND timezone IS NOT NULL";
+
+        if (theOptions.GetPopulationMin() > 0)
+        {
+          sql += " AND population>=";
+          sql += Fmi::to_string(theOptions.GetPopulationMin());
+        }
+        if (theOptions.GetPopulationMax() > 0)
+        {
+          sql += " AND population<=";
+          sql += Fmi::to_string(theOptions.GetPopulationMax());
+        }
+
+        AddCountryConditions(theOptions, sql);
+        AddFeatureConditions(theOptions, sql);
+        AddKeywordConditions(theOptions, sql);
+
+        sql += " ORDER BY distance, id";
+        if (theOptions.GetResultLimit() > 0)
+        {
+          sql += " LIMIT ";
+          sql += Fmi::to_string(theOptions.GetResultLimit());
+        }
+        break;
+      }
       case eFetchById:
       {
         auto theId = std::any_cast<int>(theParams.at(eGeonameId));
@@ -1810,23 +3046,367 @@ string Query::constructSQLStatement(SQLQueryId theQueryId,
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Check the functions and indexes needed by indexed, diacritic
+ *        insensitive and fuzzy name searches
+ *
+ * \return SQL statements for creating what is missing, in execution order
+ */
+// ----------------------------------------------------------------------
+
+std::vector<std::string> Query::MissingSearchIndexes()
+{
+  try
+  {
+    struct Requirement
+    {
+      const char* table;
+      const char* pattern;  // Regex for pg_indexes.indexdef
+      const char* ddl;
+    };
+
+    static const std::vector<Requirement> requirements{
+        {"geonames",
+         R"(lower\(\(?name\)?(::text)?\) text_pattern_ops)",
+         "CREATE INDEX geonames_lower_name_idx ON geonames (LOWER(name) text_pattern_ops)"},
+        {"alternate_geonames",
+         R"(lower\(\(?name\)?(::text)?\) text_pattern_ops)",
+         "CREATE INDEX alternate_geonames_lower_name_idx ON alternate_geonames "
+         "(LOWER(name) text_pattern_ops)"},
+        {"geonames",
+         R"(using gi(n|st) \(name gi(n|st)_trgm_ops)",
+         "CREATE INDEX geonames_name_trgm_idx ON geonames USING gin (name gin_trgm_ops)"},
+        {"alternate_geonames",
+         R"(using gi(n|st) \(name gi(n|st)_trgm_ops)",
+         "CREATE INDEX alternate_geonames_name_trgm_idx ON alternate_geonames "
+         "USING gin (name gin_trgm_ops)"},
+        {"geonames",
+         R"(locus_fold\(\(?name\)?(::text)?\) text_pattern_ops)",
+         "CREATE INDEX geonames_fold_name_idx ON geonames (locus_fold(name) text_pattern_ops)"},
+        {"alternate_geonames",
+         R"(locus_fold\(\(?name\)?(::text)?\) text_pattern_ops)",
+         "CREATE INDEX alternate_geonames_fold_name_idx ON alternate_geonames "
+         "(locus_fold(name) text_pattern_ops)"}};
+
+    pqxx::result res = conn->executeNonTransaction(
+        "SELECT tablename, indexdef FROM pg_indexes "
+        "WHERE tablename IN ('geonames', 'alternate_geonames')");
+
+    std::vector<std::string> missing;
+
+    if (conn->executeNonTransaction("SELECT 1 FROM pg_extension WHERE extname='pg_trgm'").empty())
+      missing.emplace_back("CREATE EXTENSION IF NOT EXISTS pg_trgm");
+
+    if (conn->executeNonTransaction("SELECT 1 FROM pg_proc WHERE proname='locus_fold'").empty())
+    {
+      missing.emplace_back("CREATE EXTENSION IF NOT EXISTS unaccent");
+      missing.emplace_back(locus_fold_ddl);
+    }
+
+    for (const auto& requirement : requirements)
+    {
+      const boost::regex pattern(requirement.pattern, boost::regex::icase);
+      bool found = false;
+      for (const auto& row : res)
+      {
+        if (row[0].as<string>() == requirement.table &&
+            boost::regex_search(row[1].as<string>(), pattern))
+        {
+          found = true;
+          break;
+        }
+      }
+      if (!found)
+        missing.emplace_back(requirement.ddl);
+    }
+    return missing;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the current generation of the language code table
+ */
+// ----------------------------------------------------------------------
+
 std::shared_ptr<const ISO639> Query::get_iso639_table()
 {
-  std::shared_ptr<ISO639>& iso639 = get_mutable_iso639_table();
-  return std::atomic_load(&iso639);
+  return iso639_table().get();
 }
 
-std::shared_ptr<ISO639>& Query::get_mutable_iso639_table()
+Reloadable<ISO639>& Query::iso639_table()
 {
   // Initially initialize with empty table
-  static std::shared_ptr<ISO639> iso639(new ISO639);
-  return iso639;
+  static Reloadable<ISO639> table;
+  return table;
+}
+
+Reloadable<Query::NameVariantTable>& Query::name_variant_table()
+{
+  // Initially no languages are preloaded
+  static Reloadable<NameVariantTable> table;
+  return table;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Preferred name of a place, or nullptr if there is none
+ */
+// ----------------------------------------------------------------------
+
+const std::string* Query::NameVariants::find(int theId) const
+{
+  const auto change = changes.find(theId);
+  if (change != changes.end())
+    return (change->second ? &*change->second : nullptr);
+
+  if (!loaded)
+    return nullptr;
+  const auto pos = loaded->find(theId);
+  return (pos != loaded->end() ? &pos->second : nullptr);
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Preload the preferred names of places in the given languages
+ *
+ * Name variants of these languages are then looked up from memory
+ * instead of sorting alternate_geonames for each result. Other
+ * languages are still resolved from the database. The tables are
+ * updated when alternate_geonames changes, see InvalidateOnChanges.
+ */
+// ----------------------------------------------------------------------
+
+void Query::load_name_variants(const std::vector<std::string>& theLanguages)
+{
+  try
+  {
+    iso639 = iso639_table().get();  // Use the latest language codes
+    name_variant_table().reload(
+        [&]() -> std::shared_ptr<const NameVariantTable>
+        {
+          auto table = std::make_shared<NameVariantTable>();
+          for (auto language : theLanguages)
+          {
+            Fmi::ascii_tolower(language);
+
+            QueryOptions options;
+            options.SetLanguage(language);
+            map<SQLQueryParameterId, std::any> params;
+            params[eQueryOptions] = options;
+
+            const auto res =
+                conn->executeNonTransaction(constructSQLStatement(eLoadNameVariants, params));
+
+            auto names = std::make_shared<std::unordered_map<int, std::string>>();
+            names->reserve(res.size());
+            for (const auto& row : res)
+              names->emplace(row[0].as<int>(), row[1].as<string>());
+            (*table)[language].loaded = std::move(names);
+          }
+          return table;
+        });
+    preferred_names = name_variant_table().get();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Reload the language code table
+ *
+ * The new table is built while other Query instances keep using the
+ * previous generation, which is released once no request refers to it.
+ */
+// ----------------------------------------------------------------------
+
 void Query::load_iso639_table(const std::vector<std::string>& special_codes)
 {
-  std::shared_ptr<ISO639> new_table(new ISO639(*conn, special_codes));
-  std::atomic_store(&get_mutable_iso639_table(), new_table);
+  iso639_table().reload(
+      [&]() -> std::shared_ptr<const ISO639>
+      { return std::make_shared<const ISO639>(*conn, special_codes); });
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Apply the pending changes of alternate_geonames to the name variants
+ *
+ * The preferred names of the changed places are fetched again and
+ * patched into a copy of the table with Reloadable::update. Only the
+ * changes made after the latest full load are copied, the loaded names
+ * are shared by the generations. If all names may have changed, or the
+ * changes have accumulated too much, the table is reloaded completely.
+ * If the update fails, the changes are kept pending for the next attempt.
+ */
+// ----------------------------------------------------------------------
+
+void Query::ApplyNameVariantChanges()
+{
+  auto& changes = pending_name_variant_changes();
+
+  std::set<int> ids;
+  bool everything = false;
+  {
+    std::lock_guard<std::mutex> lock(changes.mutex);
+    std::swap(ids, changes.ids);
+    std::swap(everything, changes.everything);
+  }
+
+  try
+  {
+    auto& variants = name_variant_table();
+
+    std::vector<std::string> languages;
+    for (const auto& item : *variants.get())
+      languages.push_back(item.first);
+
+    if (everything)
+    {
+      load_name_variants(languages);
+      return;
+    }
+
+    if (ids.empty())
+      return;
+
+    // Current preferred names of the changed places
+    std::map<std::string, std::unordered_map<int, std::string>> names;
+    for (const auto& language : languages)
+    {
+      QueryOptions options;
+      options.SetLanguage(language);
+      map<SQLQueryParameterId, std::any> params;
+      params[eQueryOptions] = options;
+
+      auto& language_names = names[language];
+      auto it = ids.cbegin();
+      while (it != ids.cend())
+      {
+        constexpr const size_t max_ids = 1000;  // Limit the size of the queries
+        std::vector<int> chunk;
+        while (it != ids.cend() && chunk.size() < max_ids)
+          chunk.push_back(*it++);
+        params[eGeonamesId] = std::move(chunk);
+
+        const auto res =
+            conn->executeNonTransaction(constructSQLStatement(eLoadNameVariants, params));
+        for (const auto& row : res)
+          language_names.emplace(row[0].as<int>(), row[1].as<string>());
+      }
+    }
+
+    // Places without a preferred name any more are marked removed
+    bool compact = false;
+    variants.update(
+        [&](NameVariantTable& theTable)
+        {
+          for (auto& item : theTable)
+          {
+            const auto& language_names = names[item.first];
+            auto& changed = item.second.changes;
+            for (const int id : ids)
+            {
+              const auto pos = language_names.find(id);
+              if (pos == language_names.end())
+                changed[id] = std::nullopt;
+              else
+                changed[id] = pos->second;
+            }
+            compact |= (changed.size() > max_name_variant_changes);
+          }
+        });
+    preferred_names = variants.get();
+
+    // Merge the changes into the loaded names in the next refresh
+    if (compact)
+    {
+      add_name_variant_change("");
+      variants.invalidate();
+    }
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(changes.mutex);
+    changes.everything |= everything;
+    if (!changes.everything)
+      changes.ids.insert(ids.begin(), ids.end());
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Subscribe to change notifications
+ *
+ * The data is marked outdated in the thread reporting the change and
+ * updated once the next request notices it, since only Query instances
+ * know how to connect. Changes of individual places in alternate_geonames
+ * are recorded so that only their name variants need to be fetched.
+ */
+// ----------------------------------------------------------------------
+
+void Query::InvalidateOnChanges(ChangeSource& theSource)
+{
+  theSource.subscribe(
+      [](const ChangeSource::Change& theChange)
+      {
+        if (theChange.table == "*" || theChange.table == "languages")
+        {
+          iso639_table().invalidate();
+          add_name_variant_change("");
+          name_variant_table().invalidate();
+        }
+        else if (theChange.table == "alternate_geonames")
+        {
+          add_name_variant_change(theChange.key);
+          name_variant_table().invalidate();
+        }
+      });
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Incremental refresh using the connection of this instance
+ *
+ * Subscribers are called in this thread before the method returns, and
+ * the changes recorded by InvalidateOnChanges are then applied in this
+ * thread too instead of in a background thread started by a request.
+ */
+// ----------------------------------------------------------------------
+
+std::size_t Query::PollChanges(ChangeTracker& theTracker)
+{
+  try
+  {
+    const auto count = theTracker.poll(*conn);
+
+    auto& variants = name_variant_table();
+    if (variants.generation() > 0 && variants.claim_refresh())
+    {
+      try
+      {
+        ApplyNameVariantChanges();
+      }
+      catch (...)
+      {
+        variants.retry_after(refresh_retry_delay);
+        throw;
+      }
+    }
+    return count;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
 }
 
 }  // namespace Locus
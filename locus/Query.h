@@ -6,21 +6,32 @@
 
 #pragma once
 
+#include "ChangeListener.h"
+#include "ChangeTracker.h"
+#include "FlatMap.h"
 #include "ISO639.h"
 #include "QueryOptions.h"
+#include "Ranking.h"
+#include "Reloadable.h"
 #include "SimpleLocation.h"
 #include <macgyver/PostgreSQLConnection.h>
 #include <macgyver/StringConversion.h>
 #include <macgyver/TypeTraits.h>
 #include <any>
+#include <map>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <pqxx/pqxx>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace Locus
 {
+class AutocompleteSession;
+
 class Query
 {
  public:
@@ -46,6 +57,10 @@ class Query
         const std::string& thePort);
 
   void SetDebug(bool theFlag);
+  void SetRanking(const Ranking& theRanking);
+
+  // Generation of the in-memory data used by the latest Fetch* call
+  std::size_t DataGeneration() const { return data_generation; }
 
   // Perform the queries
   return_type FetchByName(const QueryOptions& theOptions, const std::string& theName);
@@ -61,14 +76,32 @@ class Query
   return_type FetchByKeyword(const QueryOptions& theOptions, const std::string& theKeyword);
   unsigned int CountKeywordLocations(const QueryOptions& theOptions, const std::string& theKeyword);
 
+  // SQL for creating the indexes needed by indexed and fuzzy name searches which are missing
+  std::vector<std::string> MissingSearchIndexes();
+
   static std::shared_ptr<const ISO639> get_iso639_table();
 
   void load_iso639_table(
       const std::vector<std::string>& special_codes = std::vector<std::string>());
 
+  // Keep the preferred name of each place in memory for the given languages
+  void load_name_variants(const std::vector<std::string>& theLanguages);
+
+  // Update in-memory data when changes are reported to the tables it is built from
+  static void InvalidateOnChanges(ChangeSource& theSource);
+
+  // Report rows modified since the previous call to the subscribers of the tracker
+  std::size_t PollChanges(ChangeTracker& theTracker);
+
   void cancel();
 
  private:
+  friend class AutocompleteSession;
+  friend struct QueryBenchmark;  // Benchmarks of the caches of build_locations
+
+  // Connection for background refreshes
+  explicit Query(const Fmi::Database::PostgreSQLConnectionOptions& theOptions);
+
   // Helper methods
   std::string ResolveNameVariant(const QueryOptions& theOptions,
                                  int theId,
@@ -76,46 +109,136 @@ class Query
   std::map<int, std::string> ResolveNameVariants(const QueryOptions& theOptions,
                                                  const std::vector<int>& theIds);
 
-  void AddCountryConditions(const QueryOptions& theOptions, std::string& theQuery) const;
+  void AddCountryConditions(const QueryOptions& theOptions,
+                            std::string& theQuery,
+                            bool theRestrictCountries = true) const;
   void AddFeatureConditions(const QueryOptions& theOptions, std::string& theQuery) const;
   void AddKeywordConditions(const QueryOptions& theOptions, std::string& theQuery) const;
 
+  std::optional<std::string> ResolveAreaConditions(const std::vector<std::string>& theAreas);
+
+  // Name search split into the search word and the conditions for its qualifiers
+  struct NameSearch
+  {
+    std::string searchword;
+    std::string area_conditions;
+  };
+
+  // Candidate place of a name search
+  struct NameCandidate
+  {
+    int id = 0;
+    Ranking::Candidate rank;
+    std::string matched_name;  // Only if requested from FetchNameCandidates
+  };
+
+  std::optional<NameSearch> ParseNameSearch(const std::string& theName);
+  std::vector<NameCandidate> FetchNameCandidates(const QueryOptions& theOptions,
+                                                 const NameSearch& theSearch,
+                                                 bool theMatchedNames = false);
+  return_type FetchRankedLocations(const QueryOptions& theOptions,
+                                   const std::vector<NameCandidate>& theCandidates,
+                                   const NameSearch& theSearch);
+  static std::string NameSearchKey(const QueryOptions& theOptions, const std::string& theName);
+
+  return_type FetchBySimilarName(const QueryOptions& theOptions, const NameSearch& theSearch);
+
   return_type build_locations(const QueryOptions& theOptions,
                               const pqxx::result& theR,
-                              const std::string& theSearchWord,
-                              const std::string& theArea = "");
+                              const std::string& theSearchWord);
 
-  std::map<int, std::string> getNameVariants(const QueryOptions& theOptions,
-                                             const pqxx::result& theR,
-                                             const std::string& theSearchWord = "%");
+  // Lookup tables for the rows of a single result, allocated from the arena of the call
+  struct CodeLess  // Compares std::string and std::pmr::string keys without copying them
+  {
+    using is_transparent = void;
+    bool operator()(std::string_view theFirst, std::string_view theSecond) const
+    {
+      return theFirst < theSecond;
+    }
+  };
+
+  using IdNames = FlatMap<int, std::pmr::string>;
+  using CodeNames = FlatMap<std::pmr::string, std::pmr::string, CodeLess>;
+
+  IdNames getNameVariants(const QueryOptions& theOptions,
+                          const pqxx::result& theR,
+                          const std::string& theSearchWord = "%",
+                          std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
+
+  CodeNames getFeatures(const QueryOptions& theOptions,
+                        const pqxx::result& theR,
+                        std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
+
+  CodeNames getCountryNames(
+      const QueryOptions& theOptions,
+      const pqxx::result& theR,
+      std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
 
-  std::map<std::string, std::string> getFeatures(const QueryOptions& theOptions,
-                                                 const pqxx::result& theR);
+  IdNames getMunicipalityNames(
+      const QueryOptions& theOptions,
+      const pqxx::result& theR,
+      std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
 
-  std::map<std::string, std::string> getCountryNames(const QueryOptions& theOptions,
-                                                     const pqxx::result& theR);
+  CodeNames getAdministrativeNames(
+      const QueryOptions& theOptions,
+      const pqxx::result& theR,
+      std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
 
-  std::map<int, std::string> getMunicipalityNames(const QueryOptions& theOptions,
-                                                  const pqxx::result& theR);
+  FlatMap<int, int> getFmisids(
+      const QueryOptions& theOptions,
+      const pqxx::result& theR,
+      std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
 
-  std::map<std::string, std::string> getAdministrativeNames(const QueryOptions& theOptions,
-                                                            const pqxx::result& theR);
+  // Names in one of the additional languages of the options
+  struct Translations
+  {
+    std::string language;
+    IdNames names;
+    CodeNames countries;
+    IdNames municipalities;
+  };
 
-  std::map<int, int> getFmisids(const QueryOptions& theOptions, const pqxx::result& theR);
+  std::vector<Translations> getTranslations(
+      const QueryOptions& theOptions,
+      const pqxx::result& theR,
+      std::pmr::memory_resource* theArena = std::pmr::get_default_resource());
 
-  static std::vector<std::string> getLanguageCodes(const std::string& language);
+  const std::string& getLanguageCodeList(const std::string& language, std::string& unknown) const;
+  const std::string& getLanguageCodeCondition(const std::string& language,
+                                              std::string& unknown) const;
 
   void SetOptions(const QueryOptions& theOptions);
+  void RefreshStaleData();
+  void ApplyNameVariantChanges();
+
+  static Reloadable<ISO639>& iso639_table();
+
+  // Preferred alternate names of one language by geonames id. Changes
+  // made after the full load are kept apart, so that a copy-on-write
+  // update copies only them and shares the loaded names.
+  struct NameVariants
+  {
+    std::shared_ptr<const std::unordered_map<int, std::string>> loaded;
+    std::unordered_map<int, std::optional<std::string>> changes;  // nullopt if removed
+
+    const std::string* find(int theId) const;
+  };
 
-  static std::shared_ptr<ISO639>& get_mutable_iso639_table();
+  using NameVariantTable = std::map<std::string, NameVariants>;
+  static Reloadable<NameVariantTable>& name_variant_table();
 
   // ids for queries
   enum SQLQueryId : std::uint8_t
   {
     eResolveNameVariant,
     eResolveNameVariants,
+    eLoadNameVariants,
+    eResolveArea,
     eFetchByName,
+    eFetchByIds,
+    eFetchBySimilarName,
     eFetchByLonLat,
+    eFetchByRadius,
     eFetchById,
     eFetchByKeyword1,
     eFetchByKeyword2,
@@ -133,19 +256,28 @@ class Query
     eCountryIso2Code,
     eMunicipalityId,
     eLocationName,
-    eCountryPriorities,
-    eFeaturePriorities,
+    eCountryFallback,
     eLongitude,
     eLatitude,
     eRadius,
     eAdminCode,
     eGeonameId,
-    eKeyword
+    eGeonameIds,
+    eMatchedNames,
+    eKeyword,
+    eArea,
+    eAreaConditions
   };
 
   std::unique_ptr<Fmi::Database::PostgreSQLConnection> conn;  // Location database connecton
+  Fmi::Database::PostgreSQLConnectionOptions connection_options;
   bool debug = false;                                         // Print debug information if true
-  bool recursive_query = false;                               // Infinite recursion prevention
+  Ranking ranking;                                            // Order of name search results
+
+  // In-memory data pinned for the current request
+  std::size_t data_generation = 0;
+  std::shared_ptr<const ISO639> iso639 = get_iso639_table();
+  std::shared_ptr<const NameVariantTable> preferred_names = name_variant_table().get();
 
   std::string constructSQLStatement(
       SQLQueryId theQueryId,
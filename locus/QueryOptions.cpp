@@ -10,6 +10,7 @@
 #include <macgyver/Exception.h>
 #include <macgyver/Hash.h>
 #include <macgyver/StringConversion.h>
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 
@@ -17,8 +18,106 @@ using std::list;
 using std::ostringstream;
 using std::string;
 
+namespace
+{
+// Does the list contain a wildcard meaning no restrictions
+bool contains_any(const list<string>& theList)
+{
+  return std::any_of(theList.begin(),
+                     theList.end(),
+                     [](const string& value) { return value == "%" || value == "all"; });
+}
+
+// Upper case country codes without duplicates in the original order
+std::vector<string> normalize_countries(const list<string>& theCountries)
+{
+  std::vector<string> ret;
+  for (const auto& country : theCountries)
+  {
+    auto iso2 = Fmi::ascii_toupper_copy(country);
+    if (std::find(ret.begin(), ret.end(), iso2) == ret.end())
+      ret.push_back(std::move(iso2));
+  }
+  return ret;
+}
+
+// Pack a code of at most 5 letters or digits into an integer, case insensitively
+std::optional<std::uint32_t> pack_code(std::string_view theCode)
+{
+  if (theCode.empty() || theCode.size() > 5)
+    return std::nullopt;
+
+  std::uint32_t ret = 0;
+  for (char c : theCode)
+  {
+    std::uint32_t value = 0;
+    if (c >= '0' && c <= '9')
+      value = 1 + (c - '0');
+    else if (c >= 'A' && c <= 'Z')
+      value = 11 + (c - 'A');
+    else if (c >= 'a' && c <= 'z')
+      value = 11 + (c - 'a');
+    else
+      return std::nullopt;
+    ret = (ret << 6U) | value;
+  }
+  return ret;
+}
+
+// Priorities by list position, the first occurrence wins
+std::vector<std::pair<std::uint32_t, unsigned int>> make_priorities(const list<string>& theList)
+{
+  std::vector<std::pair<std::uint32_t, unsigned int>> ret;
+  unsigned int priority = 1;
+  for (const auto& value : theList)
+  {
+    auto key = pack_code(value);
+    if (key)
+      ret.emplace_back(*key, priority);
+    ++priority;
+  }
+  std::stable_sort(ret.begin(),
+                   ret.end(),
+                   [](const auto& a, const auto& b) { return a.first < b.first; });
+  ret.erase(std::unique(ret.begin(),
+                        ret.end(),
+                        [](const auto& a, const auto& b) { return a.first == b.first; }),
+            ret.end());
+  return ret;
+}
+
+unsigned int find_priority(const std::vector<std::pair<std::uint32_t, unsigned int>>& thePriorities,
+                           std::string_view theCode)
+{
+  const auto key = pack_code(theCode);
+  if (key)
+  {
+    auto pos = std::lower_bound(thePriorities.begin(),
+                                thePriorities.end(),
+                                *key,
+                                [](const auto& item, std::uint32_t value)
+                                { return item.first < value; });
+    if (pos != thePriorities.end() && pos->first == *key)
+      return pos->second;
+  }
+  return Locus::QueryOptions::default_priority;
+}
+
+}  // namespace
+
 namespace Locus
 {
+// ----------------------------------------------------------------------
+/*!
+ * Default constructor
+ */
+// ----------------------------------------------------------------------
+
+QueryOptions::QueryOptions()
+{
+  Compile();
+}
+
 // ----------------------------------------------------------------------
 /*!
  * Set countries used in search. Takes list of country codes in importance
@@ -37,6 +136,7 @@ void QueryOptions::SetCountries(const string& theCountries)
       boost::algorithm::split(countries, theCountries, boost::algorithm::is_any_of(","));
     else
       countries.clear();
+    Compile();
   }
   catch (...)
   {
@@ -58,6 +158,7 @@ void QueryOptions::SetCountries(const list<string>& theCountries)
   try
   {
     countries = theCountries;
+    Compile();
   }
   catch (...)
   {
@@ -83,6 +184,7 @@ void QueryOptions::SetExcludedCountries(const string& theCountries)
       boost::algorithm::split(excluded_countries, theCountries, boost::algorithm::is_any_of(","));
     else
       excluded_countries.clear();
+    Compile();
   }
   catch (...)
   {
@@ -105,6 +207,7 @@ void QueryOptions::SetExcludedCountries(const list<string>& theCountries)
   try
   {
     excluded_countries = theCountries;
+    Compile();
   }
   catch (...)
   {
@@ -126,6 +229,7 @@ void QueryOptions::SetResultLimit(unsigned int theLimit)
   try
   {
     result_limit = theLimit;
+    Compile();
   }
   catch (...)
   {
@@ -148,6 +252,7 @@ void QueryOptions::SetFeatures(const string& theFeatures)
   {
     if (!theFeatures.empty())
       boost::algorithm::split(features, theFeatures, boost::algorithm::is_any_of(","));
+    Compile();
   }
   catch (...)
   {
@@ -169,6 +274,7 @@ void QueryOptions::SetFeatures(const list<string>& theFeatures)
   try
   {
     features = theFeatures;
+    Compile();
   }
   catch (...)
   {
@@ -189,6 +295,7 @@ void QueryOptions::SetKeywords(const string& theKeywords)
   {
     if (!theKeywords.empty())
       boost::algorithm::split(keywords, theKeywords, boost::algorithm::is_any_of(","));
+    Compile();
   }
   catch (...)
   {
@@ -209,6 +316,7 @@ void QueryOptions::SetKeywords(const list<std::string>& theKeywords)
   try
   {
     keywords = theKeywords;
+    Compile();
   }
   catch (...)
   {
@@ -226,6 +334,7 @@ void QueryOptions::SetCharset(const string& theCharset)
   try
   {
     charset = theCharset;
+    Compile();
   }
   catch (...)
   {
@@ -247,6 +356,7 @@ void QueryOptions::SetCollation(const string& theCollation)
   try
   {
     collation = theCollation;
+    Compile();
   }
   catch (...)
   {
@@ -268,6 +378,7 @@ void QueryOptions::SetAutoCollation(bool theValue)
   try
   {
     autocollation = theValue;
+    Compile();
   }
   catch (...)
   {
@@ -316,6 +427,7 @@ void QueryOptions::SetAutocompleteMode(bool theValue)
   try
   {
     autocompletemode = theValue;
+    Compile();
   }
   catch (...)
   {
@@ -338,6 +450,7 @@ void QueryOptions::SetFullCountrySearch(bool theFlag)
   try
   {
     fullcountrysearch = theFlag;
+    Compile();
   }
   catch (...)
   {
@@ -358,6 +471,7 @@ void QueryOptions::SetSearchVariants(bool theFlag)
   try
   {
     search_variants = theFlag;
+    Compile();
   }
   catch (...)
   {
@@ -379,6 +493,55 @@ void QueryOptions::SetLanguage(const string& theLanguage)
   try
   {
     language = Fmi::ascii_tolower_copy(theLanguage);
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Set additional languages in which the names of the locations,
+ * their countries and administrative areas are returned, see
+ * SimpleLocation::translations
+ *
+ * \param theLanguages Comma separated list of languages
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetTranslations(const string& theLanguages)
+{
+  try
+  {
+    list<string> languages;
+    if (!theLanguages.empty())
+      boost::algorithm::split(languages, theLanguages, boost::algorithm::is_any_of(","));
+    SetTranslations(languages);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Set additional languages in which the names are returned
+ *
+ * \param theLanguages List of languages
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetTranslations(const list<string>& theLanguages)
+{
+  try
+  {
+    translations.clear();
+    for (const auto& language : theLanguages)
+      translations.push_back(Fmi::ascii_tolower_copy(language));
+    Compile();
   }
   catch (...)
   {
@@ -399,6 +562,7 @@ void QueryOptions::SetPopulationMin(unsigned int theValue)
   try
   {
     population_min = theValue;
+    Compile();
   }
   catch (...)
   {
@@ -419,6 +583,7 @@ void QueryOptions::SetPopulationMax(unsigned int theValue)
   try
   {
     population_max = theValue;
+    Compile();
   }
   catch (...)
   {
@@ -439,6 +604,149 @@ void QueryOptions::SetNameType(const std::string& theNameType)
   try
   {
     name_type = theNameType;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Select how radius limited lonlat searches are made. By default the
+ * nearest places are searched first and then limited by the radius,
+ * which is fast but may miss places when the result limit is set.
+ * In exact mode all places within the radius are found using the
+ * exact geodesic distance and then limited by the result limit.
+ *
+ * \param theFlag Boolean true or false
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetExactRadiusSearch(bool theFlag)
+{
+  try
+  {
+    exact_radius_search = theFlag;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Match names case insensitively without collation so that expression
+ * indexes on LOWER(name) with text_pattern_ops can be used for prefix
+ * searches. See Query::MissingSearchIndexes for the required indexes.
+ *
+ * \param theFlag Boolean true or false
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetIndexedNameSearch(bool theFlag)
+{
+  try
+  {
+    indexed_name_search = theFlag;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Match names ignoring case and diacritics so that for example "Aanekoski"
+ * finds Äänekoski. The search word is folded with NameNormalizer and
+ * compared with locus_fold(name) in the database, which can be indexed.
+ * See Query::MissingSearchIndexes for the required function and indexes,
+ * and NameNormalizer for the LC_CTYPE the database needs for non-Latin names.
+ *
+ * \param theFlag Boolean true or false
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetDiacriticInsensitiveSearch(bool theFlag)
+{
+  try
+  {
+    diacritic_insensitive_search = theFlag;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Search names similar to the search word if the normal name search
+ * returns nothing, so that for example "Helsinky" finds Helsinki.
+ * Requires the pg_trgm extension in the database.
+ *
+ * \param theFlag Boolean true or false
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetFuzzySearch(bool theFlag)
+{
+  try
+  {
+    fuzzy_search = theFlag;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set minimum trigram similarity (0-1) of names in fuzzy searches
+ *
+ * \param theThreshold The similarity limit
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetFuzzyThreshold(float theThreshold)
+{
+  try
+  {
+    if (theThreshold < 0 || theThreshold > 1)
+      throw Fmi::Exception(BCP, "Fuzzy search threshold must be in range 0-1")
+          .addParameter("Threshold", Fmi::to_string(theThreshold));
+    fuzzy_threshold = theThreshold;
+    Compile();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set time budget for fuzzy searches. Nothing is returned if the
+ *        fuzzy search takes longer.
+ *
+ * \param theMilliseconds Maximum duration of the query, 0 for no limit
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::SetFuzzyTimeout(unsigned int theMilliseconds)
+{
+  try
+  {
+    fuzzy_timeout = theMilliseconds;
+    Compile();
   }
   catch (...)
   {
@@ -486,9 +794,59 @@ string QueryOptions::Hash() const
 // ----------------------------------------------------------------------
 
 std::size_t QueryOptions::HashValue() const
+{
+  return hash_value;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Priority of a country in the country list, starting from 1
+ *
+ * \param theIso2 Country code in any case
+ * \return Position of the first occurrence or default_priority if not listed
+ */
+// ----------------------------------------------------------------------
+
+unsigned int QueryOptions::GetCountryPriority(std::string_view theIso2) const
+{
+  return find_priority(country_priorities, theIso2);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Priority of a feature code in the feature list, starting from 1
+ *
+ * \param theFeature Feature code in any case
+ * \return Position of the first occurrence or default_priority if not listed
+ */
+// ----------------------------------------------------------------------
+
+unsigned int QueryOptions::GetFeaturePriority(std::string_view theFeature) const
+{
+  return find_priority(feature_priorities, theFeature);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * Precompute everything derived from the options so that the queries
+ * need not process the option lists again. Called by all setters.
+ */
+// ----------------------------------------------------------------------
+
+void QueryOptions::Compile()
 {
   try
   {
+    all_countries = contains_any(countries);
+    all_features = features.empty() || contains_any(features);
+    all_keywords = keywords.empty() || contains_any(keywords);
+
+    country_codes = normalize_countries(countries);
+    excluded_country_codes = normalize_countries(excluded_countries);
+
+    country_priorities = make_priorities(countries);
+    feature_priorities = make_priorities(features);
+
     std::size_t hash = Fmi::hash_value(fullcountrysearch);
     Fmi::hash_combine(hash, Fmi::hash_value(language));
     Fmi::hash_combine(hash, Fmi::hash_value(result_limit));
@@ -500,6 +858,12 @@ std::size_t QueryOptions::HashValue() const
     Fmi::hash_combine(hash, Fmi::hash_value(autocollation));
     Fmi::hash_combine(hash, Fmi::hash_value(autocompletemode));
     Fmi::hash_combine(hash, Fmi::hash_value(name_type));
+    Fmi::hash_combine(hash, Fmi::hash_value(exact_radius_search));
+    Fmi::hash_combine(hash, Fmi::hash_value(indexed_name_search));
+    Fmi::hash_combine(hash, Fmi::hash_value(diacritic_insensitive_search));
+    Fmi::hash_combine(hash, Fmi::hash_value(fuzzy_search));
+    Fmi::hash_combine(hash, Fmi::hash_value(fuzzy_threshold));
+    Fmi::hash_combine(hash, Fmi::hash_value(fuzzy_timeout));
 
     for (const string& c : countries)
       Fmi::hash_combine(hash, Fmi::hash_value(c));
@@ -509,8 +873,10 @@ std::size_t QueryOptions::HashValue() const
       Fmi::hash_combine(hash, Fmi::hash_value(k));
     for (const string& c : excluded_countries)
       Fmi::hash_combine(hash, Fmi::hash_value(c));
+    for (const string& t : translations)
+      Fmi::hash_combine(hash, Fmi::hash_value(t));
 
-    return hash;
+    hash_value = hash;
   }
   catch (...)
   {
@@ -6,16 +6,25 @@
 
 #pragma once
 
+#include <cstdint>
 #include <list>
 #include <map>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace Locus
 {
 class QueryOptions
 {
  public:
+  // Priority of codes which are not listed
+  static constexpr unsigned int default_priority = 1000;
+
+  QueryOptions();
+
   // Set search conditions
 
   void SetCountries(const std::string& theCountries);
@@ -30,6 +39,8 @@ class QueryOptions
   void SetFullCountrySearch(bool theFlag);
   void SetSearchVariants(bool theFlag);
   void SetLanguage(const std::string& theLanguage);
+  void SetTranslations(const std::string& theLanguages);
+  void SetTranslations(const std::list<std::string>& theLanguages);
   void SetCharset(const std::string& theCharset);
   void SetCollation(const std::string& theCollation);
   void SetAutoCollation(bool theValue);
@@ -37,24 +48,50 @@ class QueryOptions
   void SetPopulationMin(unsigned int theValue);
   void SetPopulationMax(unsigned int theValue);
   void SetNameType(const std::string& theNameType);
+  void SetExactRadiusSearch(bool theFlag);
+  void SetIndexedNameSearch(bool theFlag);
+  void SetDiacriticInsensitiveSearch(bool theFlag);
+  void SetFuzzySearch(bool theFlag);
+  void SetFuzzyThreshold(float theThreshold);
+  void SetFuzzyTimeout(unsigned int theMilliseconds);
 
   const std::list<std::string>& GetCountries() const { return countries; }
   const std::list<std::string>& GetExcludedCountries() const { return excluded_countries; }
   unsigned int GetResultLimit() const { return result_limit; }
-  std::list<std::string> GetFeatures() const { return features; }
-  std::list<std::string> GetKeywords() const { return keywords; }
+  const std::list<std::string>& GetFeatures() const { return features; }
+  const std::list<std::string>& GetKeywords() const { return keywords; }
   bool GetFullCountrySearch() const { return fullcountrysearch; }
   bool GetSearchVariants() const { return search_variants; }
   const std::string& GetLanguage() const { return language; }
+  const std::list<std::string>& GetTranslations() const { return translations; }
   const std::string& GetCharset() const { return charset; }
   std::string GetCollation() const;
   unsigned int GetPopulationMin() const { return population_min; }
   unsigned int GetPopulationMax() const { return population_max; }
   const std::string& GetNameType() { return name_type; }
   bool GetAutoCompleteMode() const { return autocompletemode; }
+  bool GetExactRadiusSearch() const { return exact_radius_search; }
+  bool GetIndexedNameSearch() const { return indexed_name_search; }
+  bool GetDiacriticInsensitiveSearch() const { return diacritic_insensitive_search; }
+  bool GetFuzzySearch() const { return fuzzy_search; }
+  float GetFuzzyThreshold() const { return fuzzy_threshold; }
+  unsigned int GetFuzzyTimeout() const { return fuzzy_timeout; }
   std::string Hash() const;
   std::size_t HashValue() const;
 
+  // Derived from the above when the options are set
+
+  bool GetAllCountries() const { return all_countries; }
+  bool GetAllFeatures() const { return all_features; }
+  bool GetAllKeywords() const { return all_keywords; }
+  const std::vector<std::string>& GetCountryCodes() const { return country_codes; }
+  const std::vector<std::string>& GetExcludedCountryCodes() const
+  {
+    return excluded_country_codes;
+  }
+  unsigned int GetCountryPriority(std::string_view theIso2) const;
+  unsigned int GetFeaturePriority(std::string_view theFeature) const;
+
  private:
   std::list<std::string> features{"PPLC",
                                   "ADMD",
@@ -77,6 +114,7 @@ class QueryOptions
   std::list<std::string> keywords;            // Keywords to search for
   std::list<std::string> excluded_countries;  // Countries that are not used in search
   std::string language = "fi";                // Language used in results
+  std::list<std::string> translations;        // Additional languages of names in results
   std::string charset = "utf8";               // Character set used in result
   std::string name_type;                      // Can be 'fmisid','wmo','lpnn' or empty
   unsigned int result_limit = 100;            // Limit for the number of results
@@ -88,6 +126,25 @@ class QueryOptions
   std::string collation = "utf8_general_ci";  // collation for mysql
   bool autocollation = false;
   bool autocompletemode = false;
+  bool exact_radius_search = false;           // Return all places within radius in lonlat search
+  bool indexed_name_search = false;           // Match names so that expression indexes can be used
+  bool diacritic_insensitive_search = false;  // Match names by their folded search keys
+  bool fuzzy_search = false;                  // Search similar names if there are no matches
+  float fuzzy_threshold = 0.3;                // Minimum trigram similarity in fuzzy searches
+  unsigned int fuzzy_timeout = 200;           // Time budget for fuzzy searches in milliseconds
+
+  void Compile();
+
+  using Priorities = std::vector<std::pair<std::uint32_t, unsigned int>>;  // Sorted packed codes
+
+  std::size_t hash_value = 0;
+  bool all_countries = false;                       // Countries contain % or all
+  bool all_features = false;                        // Features are empty or contain % or all
+  bool all_keywords = false;                        // Keywords are empty or contain % or all
+  std::vector<std::string> country_codes;           // Upper case, no duplicates
+  std::vector<std::string> excluded_country_codes;  // Upper case, no duplicates
+  Priorities country_priorities;
+  Priorities feature_priorities;
 
 };  // class QueryOptions
 
@@ -0,0 +1,239 @@
+// ======================================================================
+/*!
+ * \brief Implementation of class Locus::Ranking
+ */
+// ======================================================================
+
+#include "Ranking.h"
+#include <boost/locale.hpp>
+#include <macgyver/Exception.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+namespace
+{
+// Only big places are prioritized by population before the country and feature priorities
+unsigned int population_priority(const Locus::Ranking::Candidate& theCandidate)
+{
+  return (theCandidate.population > 50000 ? theCandidate.population : 0);
+}
+
+const boost::locale::generator locale_generator;
+
+// Locales for the MySQL style collation names used by QueryOptions
+const std::map<std::string, std::string> collation_locales{{"danish", "da_DK"},
+                                                           {"estonian", "et_EE"},
+                                                           {"german2", "de_DE"},
+                                                           {"icelandic", "is_IS"},
+                                                           {"latvian", "lv_LV"},
+                                                           {"lithuanian", "lt_LT"},
+                                                           {"polish", "pl_PL"},
+                                                           {"spanish", "es_ES"},
+                                                           {"swedish", "sv_SE"}};
+
+}  // namespace
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief The default ranking
+ */
+// ----------------------------------------------------------------------
+
+Ranking::Ranking() : Ranking(Scorer()) {}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Ranking with a scorer, names are collated in Finnish
+ */
+// ----------------------------------------------------------------------
+
+Ranking::Ranking(Scorer theScorer) : Ranking(std::move(theScorer), locale_generator("fi_FI.UTF-8"))
+{
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Ranking with a scorer and a locale for collating names
+ */
+// ----------------------------------------------------------------------
+
+Ranking::Ranking(Scorer theScorer, const std::locale& theLocale)
+    : scorer(std::move(theScorer)), locale(theLocale)
+{
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the locale for collating names with the given collation
+ *
+ * MySQL style names such as utf8_swedish_ci are mapped to the locale of
+ * the language, the general and unicode collations to the root order of
+ * the Unicode collation algorithm. Other names are taken to be locale
+ * names. Generated locales are cached since generating one is slow.
+ */
+// ----------------------------------------------------------------------
+
+std::locale Ranking::collation_locale(const std::string& theCollation)
+{
+  try
+  {
+    static std::mutex mutex;
+    static std::map<std::string, std::locale> locales;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pos = locales.find(theCollation);
+    if (pos != locales.end())
+      return pos->second;
+
+    std::string name = theCollation;
+    if (theCollation.rfind("utf8", 0) == 0)
+    {
+      // utf8_swedish_ci, utf8mb4_general_ci etc
+      const auto first = theCollation.find('_');
+      const auto last = theCollation.rfind('_');
+      const auto language =
+          (first < last ? theCollation.substr(first + 1, last - first - 1) : std::string());
+      const auto it = collation_locales.find(language);
+      name = (it != collation_locales.end() ? it->second : "en_US");
+    }
+    if (name.find('.') == std::string::npos)
+      name += ".UTF-8";
+
+    return locales.emplace(theCollation, locale_generator(name)).first->second;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!").addParameter("Collation", theCollation);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare candidates in the default order
+ *
+ * \return Negative if the first candidate is ranked first, positive if the
+ *         second one is, and zero if they are ranked equal
+ */
+// ----------------------------------------------------------------------
+
+int Ranking::compare(const Candidate& theFirst,
+                     const Candidate& theSecond,
+                     const std::locale& theLocale) const
+{
+  try
+  {
+    if (theFirst.priority != theSecond.priority)
+      return (theFirst.priority < theSecond.priority ? -1 : 1);
+
+    const auto pop1 = population_priority(theFirst);
+    const auto pop2 = population_priority(theSecond);
+    if (pop1 != pop2)
+      return (pop1 > pop2 ? -1 : 1);
+
+    if (theFirst.country_priority != theSecond.country_priority)
+      return (theFirst.country_priority < theSecond.country_priority ? -1 : 1);
+
+    if (theFirst.feature_priority != theSecond.feature_priority)
+      return (theFirst.feature_priority < theSecond.feature_priority ? -1 : 1);
+
+    if (theFirst.population != theSecond.population)
+      return (theFirst.population > theSecond.population ? -1 : 1);
+
+    return std::use_facet<std::collate<char>>(theLocale).compare(
+        theFirst.name.data(),
+        theFirst.name.data() + theFirst.name.size(),
+        theSecond.name.data(),
+        theSecond.name.data() + theSecond.name.size());
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the first candidate is ranked before the second one
+ */
+// ----------------------------------------------------------------------
+
+bool Ranking::before(const Candidate& theFirst, const Candidate& theSecond) const
+{
+  return compare(theFirst, theSecond, locale) < 0;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return candidate indexes in rank order
+ *
+ * Candidates which compare equal keep their original order. If a limit
+ * is given, only the best candidates are selected and sorted, which
+ * takes O(n log k) time instead of O(n log n).
+ */
+// ----------------------------------------------------------------------
+
+std::vector<std::size_t> Ranking::order(const std::vector<Candidate>& theCandidates,
+                                        std::size_t theLimit) const
+{
+  return order(theCandidates, theLimit, locale);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return candidate indexes in rank order, names collated in the given locale
+ */
+// ----------------------------------------------------------------------
+
+std::vector<std::size_t> Ranking::order(const std::vector<Candidate>& theCandidates,
+                                        std::size_t theLimit,
+                                        const std::locale& theLocale) const
+{
+  try
+  {
+    std::vector<std::size_t> indexes(theCandidates.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    std::vector<double> scores;
+    if (scorer)
+    {
+      scores.reserve(theCandidates.size());
+      for (const auto& candidate : theCandidates)
+        scores.push_back(scorer(candidate));
+    }
+
+    // The original position breaks ties so that the order is the same as
+    // with a stable sort even when only part of the candidates is sorted
+
+    const auto less = [&](std::size_t a, std::size_t b)
+    {
+      if (!scores.empty() && scores[a] != scores[b])
+        return scores[a] > scores[b];
+      const int cmp = compare(theCandidates[a], theCandidates[b], theLocale);
+      if (cmp != 0)
+        return cmp < 0;
+      return a < b;
+    };
+
+    if (theLimit > 0 && theLimit < indexes.size())
+    {
+      std::partial_sort(indexes.begin(), indexes.begin() + theLimit, indexes.end(), less);
+      indexes.resize(theLimit);
+    }
+    else
+      std::sort(indexes.begin(), indexes.end(), less);
+
+    return indexes;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Locus
+
+// ======================================================================
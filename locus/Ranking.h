@@ -0,0 +1,84 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::Ranking
+ *
+ * Orders the candidates of a name search. By default the order is
+ *
+ *  1. geonames priority, smallest first
+ *  2. population of places bigger than 50000, biggest first
+ *  3. position of the country in the country list
+ *  4. position of the feature code in the feature list
+ *  5. population, biggest first
+ *  6. name in collation order
+ *
+ * An optional scorer can be given to rank candidates before the
+ * default order is applied, for example to weight population or name
+ * length in autocomplete searches. Candidates with equal scores are
+ * ranked by the default order.
+ *
+ * When only the best candidates are needed, a limit can be given to
+ * order() so that the rest are never fully sorted.
+ *
+ * Names are collated with the locale given to the constructor unless
+ * one is given to order(), for example collation_locale() of the
+ * collation in the query options.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <locale>
+#include <string>
+#include <vector>
+
+namespace Locus
+{
+class Ranking
+{
+ public:
+  struct Candidate
+  {
+    int priority = 0;  // geonames.priority
+    unsigned int population = 0;
+    unsigned int country_priority = 0;
+    unsigned int feature_priority = 0;
+    std::string name;
+  };
+
+  // Larger scores are ranked first
+  using Scorer = std::function<double(const Candidate&)>;
+
+  Ranking();
+  explicit Ranking(Scorer theScorer);
+  Ranking(Scorer theScorer, const std::locale& theLocale);
+
+  // Candidate indexes in rank order, at most theLimit of them unless the limit is zero
+  std::vector<std::size_t> order(const std::vector<Candidate>& theCandidates,
+                                 std::size_t theLimit = 0) const;
+  std::vector<std::size_t> order(const std::vector<Candidate>& theCandidates,
+                                 std::size_t theLimit,
+                                 const std::locale& theLocale) const;
+
+  // Locale for a collation name such as utf8_swedish_ci or fi_FI.UTF-8
+  static std::locale collation_locale(const std::string& theCollation);
+
+  // True if candidates are scored before the default order
+  bool has_scorer() const { return static_cast<bool>(scorer); }
+
+  // The default order
+  bool before(const Candidate& theFirst, const Candidate& theSecond) const;
+
+ private:
+  int compare(const Candidate& theFirst,
+              const Candidate& theSecond,
+              const std::locale& theLocale) const;
+
+  Scorer scorer;
+  std::locale locale;
+};  // class Ranking
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,45 @@
+// ======================================================================
+/*!
+ * \brief Implementation of generation counters for Locus::Reloadable
+ */
+// ======================================================================
+
+#include "Reloadable.h"
+#include <atomic>
+
+namespace
+{
+// Shared by all data sets so that a single number identifies the state of the library
+std::atomic<std::size_t> data_generation{0};
+}  // namespace
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the latest generation number handed out
+ *
+ * Cached query results tagged with an older number may be based on
+ * in-memory data which has since been replaced.
+ */
+// ----------------------------------------------------------------------
+
+std::size_t CurrentDataGeneration()
+{
+  return data_generation.load();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Reserve a new generation number for replaced data
+ */
+// ----------------------------------------------------------------------
+
+std::size_t NextDataGeneration()
+{
+  return ++data_generation;
+}
+
+}  // namespace Locus
+
+// ======================================================================
@@ -0,0 +1,116 @@
+// ======================================================================
+/*!
+ * \brief Interface of class Locus::Reloadable
+ *
+ * Holder for immutable in-memory data which can be replaced at run
+ * time without blocking readers. Readers take a snapshot (a shared
+ * pointer to the current generation) and keep using it for as long as
+ * they need. A reload builds a completely new generation and switches
+ * to it atomically; the old generation is released when its last
+ * reader drops its snapshot.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Locus
+{
+// Latest generation number handed out to any in-memory data set
+std::size_t CurrentDataGeneration();
+
+// Reserve the next generation number
+std::size_t NextDataGeneration();
+
+template <typename T>
+class Reloadable
+{
+ public:
+  struct Snapshot
+  {
+    std::shared_ptr<const T> data;
+    std::size_t generation = 0;
+  };
+
+  using snapshot_type = std::shared_ptr<const Snapshot>;
+  using builder_type = std::function<std::shared_ptr<const T>()>;
+
+  Reloadable() : Reloadable(std::make_shared<const T>()) {}
+
+  explicit Reloadable(std::shared_ptr<const T> theData)
+      : current(std::make_shared<const Snapshot>(Snapshot{std::move(theData), 0}))
+  {
+  }
+
+  Reloadable(const Reloadable& other) = delete;
+  Reloadable& operator=(const Reloadable& other) = delete;
+
+  // Current generation. Never blocks.
+  snapshot_type snapshot() const { return std::atomic_load(&current); }
+  std::shared_ptr<const T> get() const { return snapshot()->data; }
+  std::size_t generation() const { return snapshot()->generation; }
+
+  // Switch to new data. Readers holding the old generation are not affected.
+  void store(std::shared_ptr<const T> theData)
+  {
+    auto next =
+        std::make_shared<const Snapshot>(Snapshot{std::move(theData), NextDataGeneration()});
+    std::atomic_store(&current, std::move(next));
+  }
+
+  // Build a new generation and switch to it. Concurrent reloads are
+  // serialized so that generations are published in build order, but
+  // readers are never blocked while the new data is being built.
+  void reload(const builder_type& theBuilder)
+  {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    store(theBuilder());
+  }
+
+  // Copy-on-write modification. Readers keep seeing the old generation
+  // until the modified copy has been published.
+  void update(const std::function<void(T&)>& theModifier)
+  {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    auto copy = std::make_shared<T>(*get());
+    theModifier(*copy);
+    store(std::move(copy));
+  }
+
+  // Mark the data outdated. Readers keep using it until someone reloads.
+  void invalidate() { outdated = true; }
+  bool stale() const { return outdated; }
+
+  // Mark the data outdated after a failed refresh, the next attempt may
+  // be claimed only after the delay. Readers keep using the current data.
+  void retry_after(std::chrono::steady_clock::duration theDelay)
+  {
+    retry_time = (std::chrono::steady_clock::now() + theDelay).time_since_epoch().count();
+    outdated = true;
+  }
+
+  // Returns true for exactly one caller after invalidate(), which is then
+  // responsible for the reload (and for calling retry_after() if it fails)
+  bool claim_refresh()
+  {
+    if (!outdated || std::chrono::steady_clock::now().time_since_epoch().count() < retry_time)
+      return false;
+    return outdated.exchange(false);
+  }
+
+ private:
+  std::shared_ptr<const Snapshot> current;
+  std::mutex reload_mutex;
+  std::atomic<bool> outdated{false};
+  std::atomic<std::chrono::steady_clock::rep> retry_time{0};
+};
+
+}  // namespace Locus
+
+// ======================================================================
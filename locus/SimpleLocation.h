@@ -10,6 +10,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 
@@ -18,6 +19,13 @@ namespace Locus
 class SimpleLocation
 {
  public:
+  struct Translation
+  {
+    std::string name;
+    std::string country;
+    std::string admin;
+  };
+
   std::string name;
   float lat = 0.0;
   float lon = 0.0;
@@ -31,6 +39,11 @@ class SimpleLocation
   int id = 0;
   int elevation = 0;
   std::optional<int> fmisid;
+  std::optional<float> distance;  // Distance in kilometers from the point in lonlat searches
+  std::optional<float> bearing;   // Direction from the point in degrees clockwise from north
+
+  // Names by language, see QueryOptions::SetTranslations
+  std::map<std::string, Translation> translations;
 
   SimpleLocation(std::string theName,
                  float theLongitude,
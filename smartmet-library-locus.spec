@@ -29,6 +29,7 @@ BuildRoot: %{_tmppath}/%{name}-%{version}-%{release}-buildroot-%(%{__id_u} -n)
 
 BuildRequires: %{smartmet_boost}-devel
 BuildRequires: gcc-c++
+BuildRequires: libicu-devel
 BuildRequires: make
 BuildRequires: postgresql15-devel
 BuildRequires: %{smartmet_fmt_devel}
@@ -38,6 +39,7 @@ Requires: %{smartmet_boost}-locale
 Requires: %{smartmet_boost}-regex
 Requires: %{smartmet_boost}-system
 Requires: %{smartmet_boost}-thread
+Requires: libicu
 Requires: smartmet-library-macgyver >= 25.9.19
 
 %if 0%{?rhel} && 0%{rhel} == 8
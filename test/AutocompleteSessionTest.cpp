@@ -0,0 +1,135 @@
+#include "AutocompleteSession.h"
+#include "Query.h"
+#include <boost/lexical_cast.hpp>
+#include <macgyver/PostgreSQLConnection.h>
+#include <regression/tframe.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace AutocompleteSessionTest
+{
+// Names and ids of the results for comparisons
+
+string describe(const Query::return_type& theLocations)
+{
+  string ret;
+  for (const auto& loc : theLocations)
+    ret += loc.name + "(" + boost::lexical_cast<string>(loc.id) + ") ";
+  return ret;
+}
+
+// ----------------------------------------------------------------------
+
+void narrow_prefix()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  AutocompleteSession session(lq);
+
+  QueryOptions options;
+  options.SetAutocompleteMode(true);
+  options.SetResultLimit(10);
+
+  for (const string name : {"Hel%", "Hels%", "helsi%", "Helsinki%"})
+  {
+    const auto expected = describe(lq.FetchByName(options, name));
+    const auto result = describe(session.FetchByName(options, name));
+    if (result != expected)
+      TEST_FAILED("Search '" + name + "' returned " + result + "instead of " + expected);
+  }
+
+  if (session.DatabaseSearches() != 1 || session.NarrowedSearches() != 3)
+    TEST_FAILED("Expected 1 database search and 3 narrowed ones, got " +
+                boost::lexical_cast<string>(session.DatabaseSearches()) + " and " +
+                boost::lexical_cast<string>(session.NarrowedSearches()));
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void database_fallback()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  QueryOptions options;
+  options.SetAutocompleteMode(true);
+  options.SetResultLimit(5);
+
+  // Too many candidates to remember
+  AutocompleteSession session(lq, 1);
+  session.FetchByName(options, "Hel%");
+  session.FetchByName(options, "Hels%");
+  if (session.DatabaseSearches() != 2)
+    TEST_FAILED("Truncated candidates should not be narrowed");
+
+  // A different prefix
+  AutocompleteSession session2(lq);
+  session2.FetchByName(options, "Hel%");
+  const auto result = describe(session2.FetchByName(options, "Tur%"));
+  const auto expected = describe(lq.FetchByName(options, "Tur%"));
+  if (session2.DatabaseSearches() != 2)
+    TEST_FAILED("A new prefix should be searched in the database");
+  if (result != expected)
+    TEST_FAILED("Search 'Tur%' returned " + result + "instead of " + expected);
+
+  // Other options
+  options.SetCountries("se");
+  session2.FetchByName(options, "Turk%");
+  if (session2.DatabaseSearches() != 3)
+    TEST_FAILED("Changed options should be searched in the database");
+
+  // The candidates of a full country search may come from the fallback countries
+  options.SetFullCountrySearch(true);
+  AutocompleteSession session3(lq);
+  session3.FetchByName(options, "Hel%");
+  session3.FetchByName(options, "Hels%");
+  if (session3.DatabaseSearches() != 2)
+    TEST_FAILED("Full country searches should not be narrowed");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(narrow_prefix);
+    TEST(database_fallback);
+  }
+};  // class tests
+
+}  // namespace AutocompleteSessionTest
+
+int main(void)
+{
+  cout << endl << "AutocompleteSession tester" << endl << "==========================" << endl;
+  Fmi::Database::PostgreSQLConnection::disableReconnect();
+  AutocompleteSessionTest::tests t;
+  return t.run();
+}
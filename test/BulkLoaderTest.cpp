@@ -0,0 +1,173 @@
+#include "BulkLoader.h"
+#include <boost/lexical_cast.hpp>
+#include <regression/tframe.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace BulkLoaderTest
+{
+pqxx::connection connect()
+{
+  return pqxx::connection(string("host=") + DATABASE_HOST + " port=" + DATABASE_PORT +
+                          " dbname=" + DATABASE + " user=" + DATABASE_USER +
+                          " password=" + DATABASE_PASS);
+}
+
+// ----------------------------------------------------------------------
+
+void split()
+{
+  BulkLoader::Fields fields;
+  string buffer;
+
+  BulkLoader::split("1\tHelsinki\t\\N\t\n", fields, buffer);
+  if (fields.size() != 4)
+    TEST_FAILED("Expected 4 fields, got " + boost::lexical_cast<string>(fields.size()));
+  if (fields[0] != "1" || fields[1] != "Helsinki" || fields[2] || fields[3] != "")
+    TEST_FAILED("Failed to split a simple line");
+
+  BulkLoader::split("a\\tb\\\\c\\nd\t\\101\\x42\\\\N", fields, buffer);
+  if (fields.size() != 2)
+    TEST_FAILED("Expected 2 fields, got " + boost::lexical_cast<string>(fields.size()));
+  if (fields[0] != "a\tb\\c\nd")
+    TEST_FAILED("Failed to unescape special characters, got '" + string(*fields[0]) + "'");
+  if (fields[1] != "AB\\N")
+    TEST_FAILED("Failed to unescape octal and hex values, got '" + string(*fields[1]) + "'");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+struct Columns
+{
+  vector<int> ids;
+  vector<string> names;
+};
+
+void load()
+{
+  auto conn = connect();
+
+  // The load needs the connection for its own transaction
+  size_t expected = 0;
+  {
+    pqxx::nontransaction tx(conn);
+    expected = tx.exec("SELECT count(*) FROM geonames")[0][0].as<size_t>();
+  }
+
+  BulkLoader loader(conn, 4, 1000);
+  auto batches = loader.load<Columns>(
+      "SELECT id, name FROM geonames ORDER BY id",
+      [](Columns& theColumns, const BulkLoader::Fields& theFields)
+      {
+        theColumns.ids.push_back(stoi(string(*theFields[0])));
+        theColumns.names.emplace_back(theFields[1].value_or(""));
+      });
+
+  const auto& stats = loader.statistics();
+  if (stats.rows != expected)
+    TEST_FAILED("Expected " + boost::lexical_cast<string>(expected) + " rows, got " +
+                boost::lexical_cast<string>(stats.rows));
+
+  // Batches must be in result order
+  size_t rows = 0;
+  int previous = 0;
+  for (const auto& batch : batches)
+  {
+    for (auto id : batch.ids)
+    {
+      if (id < previous)
+        TEST_FAILED("Rows are not in result order");
+      previous = id;
+    }
+    rows += batch.ids.size();
+  }
+  if (rows != expected || batches.size() != stats.batches)
+    TEST_FAILED("Parsed " + boost::lexical_cast<string>(rows) + " rows in " +
+                boost::lexical_cast<string>(batches.size()) + " batches");
+
+  cout << "\n\t" << stats.rows << " rows, " << stats.rows_per_second() << " rows/s, peak RSS "
+       << stats.peak_rss_kb << " kB ";
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void parse_error()
+{
+  auto conn = connect();
+  BulkLoader loader(conn, 2, 10);
+
+  bool failed = false;
+  try
+  {
+    loader.load<Columns>("SELECT 'x' FROM generate_series(1,100000)",
+                         [](Columns& theColumns, const BulkLoader::Fields& theFields)
+                         { theColumns.ids.push_back(stoi(string(*theFields[0]))); });
+  }
+  catch (...)
+  {
+    failed = true;
+  }
+  if (!failed)
+    TEST_FAILED("Errors in the workers should be passed to the caller");
+
+  try
+  {
+    pqxx::nontransaction tx(conn);
+    tx.exec("SELECT 1");
+  }
+  catch (...)
+  {
+    TEST_FAILED("The connection should be usable after a failed load");
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(split);
+    TEST(load);
+    TEST(parse_error);
+  }
+};  // class tests
+
+}  // namespace BulkLoaderTest
+
+int main(void)
+{
+  cout << endl << "BulkLoader tester" << endl << "=================" << endl;
+  BulkLoaderTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,190 @@
+#include "ChangeListener.h"
+#include "Query.h"
+#include <boost/lexical_cast.hpp>
+#include <macgyver/PostgreSQLConnection.h>
+#include <regression/tframe.h>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace ChangeListenerTest
+{
+// Send a notification the same way a trigger would
+
+void notify(const string& thePayload)
+{
+  pqxx::connection conn(string("host=") + DATABASE_HOST + " port=" + DATABASE_PORT +
+                        " dbname=" + DATABASE + " user=" + DATABASE_USER +
+                        " password=" + DATABASE_PASS);
+  pqxx::nontransaction tx(conn);
+  tx.exec("NOTIFY " + string(ChangeListener::default_channel) + ", " + conn.quote(thePayload));
+}
+
+// ----------------------------------------------------------------------
+
+void parse()
+{
+  auto change = ChangeListener::parse("geonames:123");
+  if (change.table != "geonames" || change.key != "123")
+    TEST_FAILED("Failed to parse 'geonames:123', got " + change.table + " and " + change.key);
+
+  change = ChangeListener::parse("public.keywords_has_geonames:synop_fi");
+  if (change.table != "keywords_has_geonames" || change.key != "synop_fi")
+    TEST_FAILED("Schema should be removed from table name, got " + change.table);
+
+  change = ChangeListener::parse("languages");
+  if (change.table != "languages" || !change.key.empty())
+    TEST_FAILED("Failed to parse 'languages'");
+
+  change = ChangeListener::parse("");
+  if (change.table != "*")
+    TEST_FAILED("Empty payload should mean all tables, got " + change.table);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void receive_notification()
+{
+  // Declared before the listener so that they outlive its thread
+  std::mutex mutex;
+  std::condition_variable cond;
+  ChangeSource::Change received;
+
+  ChangeListener listener(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  listener.subscribe(
+      [&](const ChangeSource::Change& theChange)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received = theChange;
+        cond.notify_all();
+      });
+
+  notify("alternate_geonames:658225");
+
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait_for(lock, std::chrono::seconds(10), [&]() { return !received.table.empty(); });
+
+  if (received.table != "alternate_geonames" || received.key != "658225")
+    TEST_FAILED("Expected notification alternate_geonames:658225, got '" + received.table + ":" +
+                received.key + "'");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void reload_languages()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  lq.load_iso639_table({"fmisid"});
+
+  ChangeListener listener(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::InvalidateOnChanges(listener);
+
+  QueryOptions options;
+  lq.FetchById(options, 658225);
+  const auto generation = lq.DataGeneration();
+
+  notify("languages");
+
+  // The reload happens in the first request after the notification has arrived
+  for (int i = 0; i < 100 && lq.DataGeneration() <= generation; i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    lq.FetchById(options, 658225);
+  }
+
+  if (lq.DataGeneration() <= generation)
+    TEST_FAILED("Language codes were not reloaded after a notification");
+
+  if (!lq.get_iso639_table()->get("fmisid"))
+    TEST_FAILED("Special codes should be preserved in a reload");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void patch_name_variants()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  lq.load_name_variants({"fi"});
+
+  ChangeListener listener(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::InvalidateOnChanges(listener);
+
+  QueryOptions options;
+  options.SetLanguage("fi");
+  lq.FetchById(options, 658225);
+  const auto generation = lq.DataGeneration();
+
+  notify("alternate_geonames:658225");
+
+  // Only the names of the changed place are fetched again in the background
+  Query::return_type result;
+  for (int i = 0; i < 100 && lq.DataGeneration() <= generation; i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    result = lq.FetchById(options, 658225);
+  }
+
+  if (lq.DataGeneration() <= generation)
+    TEST_FAILED("Name variants were not updated after a notification");
+
+  if (result.size() != 1 || result[0].name != "Helsinki")
+    TEST_FAILED("Expected Helsinki after the update");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(parse);
+    TEST(receive_notification);
+    TEST(reload_languages);
+    TEST(patch_name_variants);
+  }
+};  // class tests
+
+}  // namespace ChangeListenerTest
+
+int main(void)
+{
+  cout << endl << "ChangeListener tester" << endl << "=====================" << endl;
+  Fmi::Database::PostgreSQLConnection::disableReconnect();
+  ChangeListenerTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,156 @@
+#include "ChangeTracker.h"
+#include <boost/lexical_cast.hpp>
+#include <macgyver/PostgreSQLConnection.h>
+#include <regression/tframe.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace ChangeTrackerTest
+{
+// The tracked table is a temporary one, hence it exists only in this connection
+
+void connect(Fmi::Database::PostgreSQLConnection& theConn, int theRows)
+{
+  Fmi::Database::PostgreSQLConnectionOptions opt;
+  opt.host = DATABASE_HOST;
+  opt.port = boost::lexical_cast<unsigned int>(DATABASE_PORT);
+  opt.username = DATABASE_USER;
+  opt.password = DATABASE_PASS;
+  opt.database = DATABASE;
+  opt.encoding = "UTF8";
+  theConn.open(opt);
+
+  theConn.executeNonTransaction(
+      "CREATE TEMP TABLE locus_tracker_test (id integer, last_modified bigint)");
+  theConn.executeNonTransaction(
+      "INSERT INTO locus_tracker_test SELECT i, 1 FROM generate_series(1," +
+      boost::lexical_cast<string>(theRows) + ") AS i");
+}
+
+string to_string(vector<string> theKeys)
+{
+  sort(theKeys.begin(), theKeys.end());
+  string ret;
+  for (const auto& key : theKeys)
+    ret += (ret.empty() ? "" : ",") + key;
+  return ret;
+}
+
+// ----------------------------------------------------------------------
+
+void report_changes()
+{
+  Fmi::Database::PostgreSQLConnection conn;
+  connect(conn, 10);
+
+  ChangeTracker tracker("last_modified", {{"locus_tracker_test", "id"}});
+
+  vector<string> keys;
+  bool fail = false;
+  tracker.subscribe(
+      [&](const ChangeSource::Change& theChange)
+      {
+        if (fail)
+          throw runtime_error("Simulated handler failure");
+        keys.push_back(theChange.key);
+      });
+
+  if (tracker.poll(conn) != 0)
+    TEST_FAILED("The first poll should only record the current state");
+
+  conn.executeNonTransaction(
+      "UPDATE locus_tracker_test SET last_modified=2 WHERE id IN (3,5)");
+  auto count = tracker.poll(conn);
+  if (count != 2 || to_string(keys) != "3,5")
+    TEST_FAILED("Expected changes 3,5, got " + to_string(keys));
+
+  keys.clear();
+  count = tracker.poll(conn);
+  if (count != 0 || !keys.empty())
+    TEST_FAILED("Changes should be reported only once, got " + to_string(keys));
+
+  // The watermark must not advance if a handler fails
+  conn.executeNonTransaction("UPDATE locus_tracker_test SET last_modified=3 WHERE id=7");
+  fail = true;
+  tracker.poll(conn);
+  fail = false;
+
+  keys.clear();
+  tracker.poll(conn);
+  if (to_string(keys) != "7")
+    TEST_FAILED("Changes should be reported again after a handler failed, got " +
+                to_string(keys));
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void bulk_update()
+{
+  Fmi::Database::PostgreSQLConnection conn;
+  connect(conn, static_cast<int>(ChangeTracker::max_keys) + 10);
+
+  ChangeTracker tracker("last_modified", {{"locus_tracker_test", "id"}});
+
+  vector<string> keys;
+  tracker.subscribe([&](const ChangeSource::Change& theChange)
+                    { keys.push_back(theChange.key); });
+
+  tracker.poll(conn);
+  conn.executeNonTransaction("UPDATE locus_tracker_test SET last_modified=2");
+
+  const auto count = tracker.poll(conn);
+  if (count != 1 || keys.size() != 1 || !keys[0].empty())
+    TEST_FAILED("A bulk update should be reported as a change of the whole table, got " +
+                boost::lexical_cast<string>(keys.size()) + " changes");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(report_changes);
+    TEST(bulk_update);
+  }
+};  // class tests
+
+}  // namespace ChangeTrackerTest
+
+int main(void)
+{
+  cout << endl << "ChangeTracker tester" << endl << "====================" << endl;
+  Fmi::Database::PostgreSQLConnection::disableReconnect();
+  ChangeTrackerTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,114 @@
+#include "FlatMap.h"
+#include <boost/lexical_cast.hpp>
+#include <regression/tframe.h>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace Locus;
+
+namespace FlatMapTest
+{
+// ----------------------------------------------------------------------
+
+void find()
+{
+  FlatMap<int, string> map;
+  for (int i = 100; i > 0; i -= 3)
+    map.add(i, "value " + boost::lexical_cast<string>(i));
+  map.sort();
+
+  if (map.size() != 34)
+    TEST_FAILED("Expected 34 elements, got " + boost::lexical_cast<string>(map.size()));
+
+  for (int i = 0; i <= 101; i++)
+  {
+    auto pos = map.find(i);
+    const bool expected = (i % 3 == 1);
+    if (expected != (pos != map.end()))
+      TEST_FAILED("Wrong result when searching for " + boost::lexical_cast<string>(i));
+    if (expected && pos->second != "value " + boost::lexical_cast<string>(i))
+      TEST_FAILED("Wrong value for " + boost::lexical_cast<string>(i) + ": " + pos->second);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void duplicates()
+{
+  FlatMap<int, string> first;
+  FlatMap<int, string> last;
+  for (const auto& item : {make_pair(2, "a"), make_pair(1, "b"), make_pair(2, "c"),
+                           make_pair(1, "d"), make_pair(2, "e")})
+  {
+    first.add(item.first, item.second);
+    last.add(item.first, item.second);
+  }
+  first.sort(FlatMap<int, string>::Duplicates::KeepFirst);
+  last.sort(FlatMap<int, string>::Duplicates::KeepLast);
+
+  if (first.size() != 2 || first.find(1)->second != "b" || first.find(2)->second != "a")
+    TEST_FAILED("The first added values should have been kept");
+
+  if (last.size() != 2 || last.find(1)->second != "d" || last.find(2)->second != "e")
+    TEST_FAILED("The last added values should have been kept");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+struct Less
+{
+  using is_transparent = void;
+  bool operator()(string_view a, string_view b) const { return a < b; }
+};
+
+void arena_strings()
+{
+  std::pmr::monotonic_buffer_resource arena;
+  FlatMap<std::pmr::string, std::pmr::string, Less> map(&arena);
+  map.add(string_view("FI"), "Finland, a name long enough not to fit the small string buffer");
+  map.add(string_view("SE"), "Sweden");
+  map.sort();
+
+  // Lookups with ordinary strings
+  const string fi = "FI";
+  auto pos = map.find(fi);
+  if (pos == map.end() || pos->second.get_allocator().resource() != &arena)
+    TEST_FAILED("Values should be allocated from the arena");
+
+  if (map.contains(string("NO")) || !map.contains(string_view("SE")))
+    TEST_FAILED("Failed to search with string keys");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(find);
+    TEST(duplicates);
+    TEST(arena_strings);
+  }
+};  // class tests
+
+}  // namespace FlatMapTest
+
+int main(void)
+{
+  cout << endl << "FlatMap tester" << endl << "==============" << endl;
+  FlatMapTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,202 @@
+#include "GreatCircle.h"
+#include <boost/lexical_cast.hpp>
+#include <regression/tframe.h>
+#include <pqxx/pqxx>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace GreatCircleTest
+{
+// Largest difference in kilometers between the kernel and the double precision formula
+double max_error(DistanceKernel theKernel,
+                 float theLongitude,
+                 float theLatitude,
+                 const vector<float>& theLongitudes,
+                 const vector<float>& theLatitudes)
+{
+  vector<float> distances(theLongitudes.size());
+  GreatCircleDistances(theLongitude,
+                       theLatitude,
+                       theLongitudes.data(),
+                       theLatitudes.data(),
+                       theLongitudes.size(),
+                       distances.data(),
+                       theKernel);
+
+  double error = 0;
+  for (size_t i = 0; i < distances.size(); i++)
+  {
+    const double expected =
+        GreatCircleDistance(theLongitude, theLatitude, theLongitudes[i], theLatitudes[i]);
+    error = max(error, fabs(distances[i] - expected));
+  }
+  return error;
+}
+
+// ----------------------------------------------------------------------
+
+void distance()
+{
+  double d = GreatCircleDistance(24.94, 60.17, 24.94, 60.17);
+  if (d != 0)
+    TEST_FAILED("Distance to the point itself should be zero, got " +
+                boost::lexical_cast<string>(d));
+
+  // Helsinki - Stockholm
+  d = GreatCircleDistance(24.94, 60.17, 18.07, 59.33);
+  if (fabs(d - 395.8) > 0.1)
+    TEST_FAILED("Expected 395.8 km from Helsinki to Stockholm, got " +
+                boost::lexical_cast<string>(d));
+
+  // Half a circumference
+  d = GreatCircleDistance(0, 0, 180, 0);
+  if (fabs(d - M_PI * earth_radius) > 1e-6)
+    TEST_FAILED("Expected half a circumference between antipodes, got " +
+                boost::lexical_cast<string>(d));
+
+  // Across the antimeridian
+  d = GreatCircleDistance(179.5, 0, -179.5, 0);
+  if (fabs(d - M_PI / 180 * earth_radius) > 1e-6)
+    TEST_FAILED("Expected one degree across the antimeridian, got " +
+                boost::lexical_cast<string>(d));
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void kernels()
+{
+  mt19937 generator(1);
+  uniform_real_distribution<float> longitude(-180, 180);
+  uniform_real_distribution<float> latitude(-90, 90);
+
+  // Odd sizes exercise the padding of the last vector
+  for (size_t n : {0, 1, 7, 9, 1001})
+  {
+    vector<float> lons(n);
+    vector<float> lats(n);
+    for (size_t i = 0; i < n; i++)
+    {
+      lons[i] = longitude(generator);
+      lats[i] = latitude(generator);
+    }
+
+    // Include the point itself, its antipode and points near the poles
+    const vector<pair<float, float>> points = {
+        {24.94f, 60.17f}, {0, 90}, {-179.9f, -89.9f}, {179.99f, 0.01f}};
+    for (const auto& point : points)
+    {
+      if (n > 2)
+      {
+        lons[0] = point.first;
+        lats[0] = point.second;
+        lons[1] = (point.first > 0 ? point.first - 180 : point.first + 180);
+        lats[1] = -point.second;
+      }
+
+      for (auto kernel : {DistanceKernel::Scalar, DistanceKernel::AVX2})
+      {
+        const double error = max_error(kernel, point.first, point.second, lons, lats);
+        if (error > 0.01)
+          TEST_FAILED("Kernel error " + boost::lexical_cast<string>(error) + " km at " +
+                      boost::lexical_cast<string>(point.first) + "," +
+                      boost::lexical_cast<string>(point.second) + " with " +
+                      boost::lexical_cast<string>(n) + " points");
+      }
+    }
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void postgis()
+{
+  pqxx::connection conn(string("host=") + DATABASE_HOST + " port=" + DATABASE_PORT +
+                        " dbname=" + DATABASE + " user=" + DATABASE_USER +
+                        " password=" + DATABASE_PASS);
+  pqxx::nontransaction tx(conn);
+
+  const float lon = 24.94f;
+  const float lat = 60.17f;
+
+  auto res = tx.exec(
+      "SELECT lon, lat, ST_Distance(ST_GeographyFromText('POINT(24.94 60.17)'), the_geog, true)"
+      " FROM geonames WHERE timezone IS NOT NULL ORDER BY id LIMIT 10000");
+
+  vector<float> lons;
+  vector<float> lats;
+  vector<double> expected;
+  for (const auto& row : res)
+  {
+    lons.push_back(row[0].as<float>());
+    lats.push_back(row[1].as<float>());
+    expected.push_back(row[2].as<double>() / 1000);
+  }
+
+  for (auto kernel : {DistanceKernel::Scalar, DistanceKernel::AVX2})
+  {
+    vector<float> distances(lons.size());
+    GreatCircleDistances(
+        lon, lat, lons.data(), lats.data(), lons.size(), distances.data(), kernel);
+
+    // The sphere differs from the WGS84 spheroid by up to about half a percent
+    for (size_t i = 0; i < distances.size(); i++)
+      if (fabs(distances[i] - expected[i]) > 0.006 * expected[i] + 0.01)
+        TEST_FAILED("Distance to " + boost::lexical_cast<string>(lons[i]) + "," +
+                    boost::lexical_cast<string>(lats[i]) + " is " +
+                    boost::lexical_cast<string>(distances[i]) + " km, PostGIS gives " +
+                    boost::lexical_cast<string>(expected[i]) + " km");
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(distance);
+    TEST(kernels);
+    TEST(postgis);
+  }
+};  // class tests
+
+}  // namespace GreatCircleTest
+
+int main(void)
+{
+  cout << endl << "GreatCircle tester" << endl << "==================" << endl;
+  GreatCircleTest::tests t;
+  return t.run();
+}
@@ -95,6 +95,88 @@ void search_by_iso_639_1_name()
   TEST_PASSED();
 }
 
+void precomputed_codes()
+{
+  ISO639 iso639;
+  iso639.add({std::string("fi"), std::string("fin"), "fin", ""});
+  iso639.add({std::string("fo"), std::string("bar"), "foo", ""});
+  iso639.add_special_code("fmisid");
+
+  const ISO639::Codes* codes = iso639.find_codes("fi");
+  if (!codes)
+    TEST_FAILED("Did not find codes for 'fi'");
+  if (codes->sql_condition != " in ('fin', 'fi') ")
+    TEST_FAILED("Got SQL condition '" + codes->sql_condition + "' for 'fi'");
+
+  if (iso639.find_codes("fin") != codes)
+    TEST_FAILED("All codes of a language should share the same precomputed codes");
+
+  codes = iso639.find_codes("bar");
+  if (!codes || codes->sql_list != "'foo', 'bar', 'fo'")
+    TEST_FAILED("Wrong code list for 'bar'");
+
+  codes = iso639.find_codes("fmisid");
+  if (!codes || codes->sql_condition != "='fmisid'")
+    TEST_FAILED("Wrong SQL condition for special code 'fmisid'");
+
+  if (iso639.find_codes("xx"))
+    TEST_FAILED("Unknown language should not have codes");
+
+  TEST_PASSED();
+}
+
+void invalid_and_special_codes()
+{
+  ISO639 iso639;
+  iso639.add({std::string("fi"), std::string("fin"), "fin", ""});
+
+  bool failed = false;
+  try
+  {
+    iso639.add({std::string("fi"), std::nullopt, "fix", ""});
+  }
+  catch (...)
+  {
+    failed = true;
+  }
+  if (!failed)
+    TEST_FAILED("Duplicate ISO 639-1 code should be rejected");
+  if (iso639.find("fix"))
+    TEST_FAILED("Rejected entry should not be added");
+
+  failed = false;
+  try
+  {
+    iso639.add({std::nullopt, std::nullopt, "FIX", ""});
+  }
+  catch (...)
+  {
+    failed = true;
+  }
+  if (!failed)
+    TEST_FAILED("Upper case ISO 639-3 code should be rejected");
+
+  iso639.add_special_code("wmo");
+  iso639.add_special_code("lpnn");
+  iso639.add_special_code("lpnn");
+
+  if (iso639.get_special_codes().size() != 2)
+    TEST_FAILED("Special codes should be added only once");
+
+  const ISO639::Entry* entry = iso639.find("lpnn");
+  if (!entry || entry->iso639_3 != "lpnn")
+    TEST_FAILED("Searching lpnn should return special codes");
+
+  entry = iso639.find("wmo");
+  if (!entry || entry->iso639_3 != "wmo")
+    TEST_FAILED("Searching wmo should return special codes");
+
+  if (iso639.find("lp"))
+    TEST_FAILED("Prefix of a special code should not be found");
+
+  TEST_PASSED();
+}
+
 void load_from_geonames_and_search()
 {
   Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
@@ -187,6 +269,8 @@ class tests : public tframe::tests
   void test(void)
   {
     TEST(search_by_iso_639_1_name);
+    TEST(precomputed_codes);
+    TEST(invalid_and_special_codes);
     TEST(load_from_geonames_and_search);
   }
 };
@@ -0,0 +1,270 @@
+#include "LocationStore.h"
+#include <boost/lexical_cast.hpp>
+#include <regression/tframe.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace LocationStoreTest
+{
+LocationStore sample()
+{
+  LocationStore store;
+  store.add(658225, "Helsinki", 24.94f, 60.17f, 558457, 26, "PPLC", "FI", "Europe/Helsinki", 91);
+  store.add(660158, "Espoo", 24.65f, 60.21f, 256760, 10, "PPLA3", "FI", "Europe/Helsinki", 49);
+  store.add(2673730, "Stockholm", 18.07f, 59.33f, 1515017, 28, "PPLC", "SE", "Europe/Stockholm");
+  store.add(660129, "Espoonlahti", 24.62f, 60.13f, 0, 0, "BAY", "FI", "Europe/Helsinki");
+  return store;
+}
+
+string to_string(const vector<LocationStore::index_type>& theRows)
+{
+  string ret;
+  for (auto row : theRows)
+    ret += (ret.empty() ? "" : ",") + boost::lexical_cast<string>(row);
+  return ret;
+}
+
+// ----------------------------------------------------------------------
+
+void add()
+{
+  auto store = sample();
+
+  if (store.size() != 4)
+    TEST_FAILED("Expected 4 locations, got " + boost::lexical_cast<string>(store.size()));
+
+  if (store.name(0) != "Helsinki" || store.name(1) != "Espoo" || store.name(3) != "Espoonlahti")
+    TEST_FAILED("Names are not stored correctly");
+
+  if (store.id(2) != 2673730 || store.iso2(2) != "SE" || store.feature(2) != "PPLC" ||
+      store.timezone(2) != "Europe/Stockholm" || store.population(2) != 1515017 ||
+      store.elevation(2) != 28 || store.municipality(2) != 0 || store.latitude(2) != 59.33f)
+    TEST_FAILED("Attributes of Stockholm are not stored correctly");
+
+  if (store.municipality(0) != 91)
+    TEST_FAILED("Municipality of Helsinki is not stored correctly");
+
+  auto pos = store.find(2673730);
+  if (!pos || *pos != 2)
+    TEST_FAILED("Failed to find Stockholm by id");
+  if (store.find(1))
+    TEST_FAILED("Found a location which does not exist");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void select()
+{
+  auto store = sample();
+
+  LocationStore::Filter filter;
+  auto result = to_string(store.select(filter));
+  if (result != "0,1,2,3")
+    TEST_FAILED("Empty filter should accept all locations, got " + result);
+
+  filter.countries = {"FI"};
+  result = to_string(store.select(filter));
+  if (result != "0,1,3")
+    TEST_FAILED("Expected 0,1,3 for FI, got " + result);
+
+  filter.features = {"PPLC", "PPLA3"};
+  result = to_string(store.select(filter));
+  if (result != "0,1")
+    TEST_FAILED("Expected 0,1 for FI populated places, got " + result);
+
+  filter.population_min = 300000;
+  result = to_string(store.select(filter));
+  if (result != "0")
+    TEST_FAILED("Expected 0 for FI populated places with population >= 300000, got " + result);
+
+  filter = LocationStore::Filter();
+  filter.population_max = 300000;
+  result = to_string(store.select(filter));
+  if (result != "1,3")
+    TEST_FAILED("Expected 1,3 for population <= 300000, got " + result);
+
+  filter = LocationStore::Filter();
+  filter.countries = {"XX"};
+  result = to_string(store.select(filter));
+  if (!result.empty())
+    TEST_FAILED("Unknown country should match nothing, got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void append()
+{
+  LocationStore store;
+  store.add(1, "Stockholm", 18.07f, 59.33f, 1515017, 28, "PPLC", "SE", "Europe/Stockholm");
+
+  auto other = sample();
+  store.append(other);
+
+  if (store.size() != 5)
+    TEST_FAILED("Expected 5 locations, got " + boost::lexical_cast<string>(store.size()));
+
+  // Dictionary ids of the other store must be translated
+  if (store.iso2(1) != "FI" || store.timezone(1) != "Europe/Helsinki" ||
+      store.feature(4) != "BAY" || store.iso2(3) != "SE")
+    TEST_FAILED("Codes of appended locations are not translated correctly");
+
+  if (store.name(0) != "Stockholm" || store.name(1) != "Helsinki" || store.name(4) != "Espoonlahti")
+    TEST_FAILED("Names of appended locations are not stored correctly");
+
+  auto pos = store.find(660129);
+  if (!pos || *pos != 4)
+    TEST_FAILED("Failed to find an appended location by id");
+
+  LocationStore::Filter filter;
+  filter.countries = {"SE"};
+  auto result = to_string(store.select(filter));
+  if (result != "0,3")
+    TEST_FAILED("Expected 0,3 for SE, got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void nearest()
+{
+  auto store = sample();
+
+  // Near Espoo
+  auto result = store.nearest(24.66f, 60.20f, 0, 0);
+  if (result.size() != 4 || result[0].index != 1 || result[1].index != 3 ||
+      result[2].index != 0 || result[3].index != 2)
+    TEST_FAILED("Locations are not in distance order");
+  if (result[0].distance > 2)
+    TEST_FAILED("Espoo should be within 2 km, got " +
+                boost::lexical_cast<string>(result[0].distance));
+
+  result = store.nearest(24.66f, 60.20f, 20, 0);
+  if (result.size() != 3)
+    TEST_FAILED("Expected 3 locations within 20 km, got " +
+                boost::lexical_cast<string>(result.size()));
+
+  result = store.nearest(24.66f, 60.20f, 0, 2);
+  if (result.size() != 2 || result[0].index != 1 || result[1].index != 3)
+    TEST_FAILED("Expected the 2 nearest locations");
+
+  LocationStore::Filter filter;
+  filter.features = {"PPLC"};
+  result = store.nearest(24.66f, 60.20f, 0, 0, filter);
+  if (result.size() != 2 || result[0].index != 0 || result[1].index != 2)
+    TEST_FAILED("Expected Helsinki and Stockholm as the nearest capitals");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void reverse_geocode()
+{
+  auto store = sample();
+
+  const vector<LocationStore::Point> points = {{24.95f, 60.17f}, {18.0f, 59.3f}, {0, 0}};
+  auto result = store.nearest(points, 100);
+
+  if (result.size() != 3)
+    TEST_FAILED("Expected one result per point");
+  if (!result[0] || result[0]->index != 0)
+    TEST_FAILED("Expected Helsinki for the first point");
+  if (!result[1] || result[1]->index != 2)
+    TEST_FAILED("Expected Stockholm for the second point");
+  if (result[2])
+    TEST_FAILED("Expected nothing within 100 km of 0,0");
+
+  LocationStore::Filter filter;
+  filter.countries = {"SE"};
+  result = store.nearest(points, 0, filter);
+  if (!result[0] || result[0]->index != 2 || !result[2] || result[2]->index != 2)
+    TEST_FAILED("Expected Stockholm for all points when searching Sweden only");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void load()
+{
+  pqxx::connection conn(string("host=") + DATABASE_HOST + " port=" + DATABASE_PORT +
+                        " dbname=" + DATABASE + " user=" + DATABASE_USER +
+                        " password=" + DATABASE_PASS);
+
+  // The load needs the connection for its own transaction
+  size_t expected = 0;
+  {
+    pqxx::nontransaction tx(conn);
+    expected =
+        tx.exec("SELECT count(*) FROM geonames WHERE timezone IS NOT NULL")[0][0].as<size_t>();
+  }
+
+  LocationStore store;
+  store.load(conn, 4);
+
+  if (store.size() != expected)
+    TEST_FAILED("Expected " + boost::lexical_cast<string>(expected) + " locations, got " +
+                boost::lexical_cast<string>(store.size()));
+
+  auto pos = store.find(658225);
+  if (!pos)
+    TEST_FAILED("Failed to find Helsinki");
+  if (store.name(*pos) != "Helsinki" || store.iso2(*pos) != "FI" ||
+      store.timezone(*pos) != "Europe/Helsinki")
+    TEST_FAILED("Helsinki was not loaded correctly");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(add);
+    TEST(select);
+    TEST(append);
+    TEST(nearest);
+    TEST(reverse_geocode);
+    TEST(load);
+  }
+};  // class tests
+
+}  // namespace LocationStoreTest
+
+int main(void)
+{
+  cout << endl << "LocationStore tester" << endl << "====================" << endl;
+  LocationStoreTest::tests t;
+  return t.run();
+}
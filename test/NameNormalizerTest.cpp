@@ -0,0 +1,78 @@
+#include "NameNormalizer.h"
+#include <regression/tframe.h>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+namespace NameNormalizerTest
+{
+// ----------------------------------------------------------------------
+
+void fold()
+{
+  NameNormalizer normalizer;
+
+  const vector<pair<string, string>> tests{{"Äänekoski", "aanekoski"},
+                                           {"ÄÄNEKOSKI", "aanekoski"},
+                                           {"aanekoski", "aanekoski"},
+                                           {"Åland", "aland"},
+                                           {"Tromsø", "tromso"},
+                                           {"Čáhcesuolu", "cahcesuolu"},
+                                           {"Straße", "strasse"},
+                                           {"Jyväs%", "jyvas%"},
+                                           {"Москва", "москва"}};
+
+  for (const auto& test : tests)
+  {
+    const auto result = normalizer.normalize(test.first);
+    if (result != test.second)
+      TEST_FAILED("Expected " + test.second + " for " + test.first + ", got " + result);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void transliterate()
+{
+  NameNormalizer normalizer(true);
+
+  string result = normalizer.normalize("Москва");
+  if (result != "moskva")
+    TEST_FAILED("Expected moskva, got " + result);
+
+  result = normalizer.normalize("Äänekoski");
+  if (result != "aanekoski")
+    TEST_FAILED("Expected aanekoski, got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(fold);
+    TEST(transliterate);
+  }
+};  // class tests
+
+}  // namespace NameNormalizerTest
+
+int main(void)
+{
+  cout << endl << "NameNormalizer tester" << endl << "=====================" << endl;
+  NameNormalizerTest::tests t;
+  return t.run();
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 using namespace boost;
@@ -28,13 +29,78 @@ void hash()
 
 // ----------------------------------------------------------------------
 
+void hash_value()
+{
+  Locus::QueryOptions options1;
+  Locus::QueryOptions options2;
+
+  if (options1.HashValue() != options2.HashValue())
+    TEST_FAILED("Equal options should have equal hash values");
+
+  options2.SetCountries("fi,se");
+  if (options1.HashValue() == options2.HashValue())
+    TEST_FAILED("Hash value should change when countries change");
+
+  options1.SetCountries("fi,se");
+  if (options1.HashValue() != options2.HashValue())
+    TEST_FAILED("Hash value should be updated by setters");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void compiled_options()
+{
+  Locus::QueryOptions options;
+  options.SetCountries("fi,SE,fi,no");
+  options.SetExcludedCountries("ax");
+
+  if (options.GetAllCountries())
+    TEST_FAILED("Country list does not contain all countries");
+
+  const vector<string> expected{"FI", "SE", "NO"};
+  if (options.GetCountryCodes() != expected)
+    TEST_FAILED("Country codes should be in upper case without duplicates");
+
+  if (options.GetExcludedCountryCodes() != vector<string>{"AX"})
+    TEST_FAILED("Excluded country codes should be in upper case");
+
+  if (options.GetCountryPriority("FI") != 1 || options.GetCountryPriority("se") != 2 ||
+      options.GetCountryPriority("NO") != 4)
+    TEST_FAILED("Wrong country priorities");
+
+  if (options.GetCountryPriority("DK") != Locus::QueryOptions::default_priority)
+    TEST_FAILED("Unlisted country should have the default priority");
+
+  if (options.GetFeaturePriority("PPLC") != 1 || options.GetFeaturePriority("PPLA2") != 4)
+    TEST_FAILED("Wrong feature priorities");
+
+  options.SetCountries("fi,all");
+  if (!options.GetAllCountries())
+    TEST_FAILED("Country list should contain all countries");
+
+  options.SetFeatures("%");
+  if (!options.GetAllFeatures())
+    TEST_FAILED("Feature list % should allow all features");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
 // The actual test driver
 class tests : public tframe::tests
 {
   //! Overridden message separator
   virtual const char* error_message_prefix() const { return "\n\t"; }
   //! Main test suite
-  void test(void) { TEST(hash); }
+  void test(void)
+  {
+    TEST(hash);
+    TEST(hash_value);
+    TEST(compiled_options);
+  }
 };  // class tests
 
 }  // namespace QueryOptionsTest
@@ -217,6 +217,15 @@ void search_with_area()
     TEST_FAILED("Should find 1 Kumpula,Helsinki (lang=en), not " +
                 lexical_cast<string>(ret.size()));
 
+  ret = lq.FetchByName(options, "Kumpula, Helsinki, Suomi");
+  if (ret.size() != 1)
+    TEST_FAILED("Should find 1 Kumpula, Helsinki, Suomi, not " + lexical_cast<string>(ret.size()));
+
+  ret = lq.FetchByName(options, "Kumpula,Nowhereland");
+  if (!ret.empty())
+    TEST_FAILED("Should find no Kumpula in an unknown area, not " +
+                lexical_cast<string>(ret.size()));
+
   options.SetCountries("all");
   ret = lq.FetchByName(options, "Bago");
   if (ret.empty())
@@ -387,6 +396,217 @@ void specific_countries()
 
 // ----------------------------------------------------------------------
 
+void full_country_search()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::return_type ret;
+
+  QueryOptions options;
+  options.SetCountries("cz,sk");
+  options.SetSearchVariants(false);
+  options.SetFullCountrySearch(true);
+
+  // Found in the listed countries, others are not used
+
+  ret = lq.FetchByName(options, "Praha");
+  if (ret.empty())
+    TEST_FAILED("Should find Praha");
+  for (const auto& loc : ret)
+    if (loc.iso2 != "CZ" && loc.iso2 != "SK")
+      TEST_FAILED("Should find only places in CZ or SK, found one in " + loc.iso2);
+
+  // Not found in the listed countries, search all
+
+  ret = lq.FetchByName(options, "Helsinki");
+  if (ret.empty())
+    TEST_FAILED("Should find Helsinki outside the listed countries");
+  if (ret[0].iso2 != "FI")
+    TEST_FAILED("Helsinki should be found in FI, not " + ret[0].iso2);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void indexed_name_search()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::return_type ret;
+
+  QueryOptions options;
+  options.SetIndexedNameSearch(true);
+
+  ret = lq.FetchByName(options, "HELSINKI");
+  if (ret.empty())
+    TEST_FAILED("Should find Helsinki case insensitively");
+  if (ret[0].name != "Helsinki")
+    TEST_FAILED("Name of first match should be Helsinki, not " + ret[0].name);
+
+  ret = lq.FetchByName(options, "jyväs%");
+  if (ret.empty())
+    TEST_FAILED("Should find Jyväskylä with a prefix search");
+
+  // The local test database has the indexes of sql/search-indexes.sql, other
+  // databases may lack them but only the documented statements may be reported
+
+  for (const auto& ddl : lq.MissingSearchIndexes())
+  {
+    if (ddl.rfind("CREATE INDEX ", 0) != 0 &&
+        ddl.rfind("CREATE EXTENSION IF NOT EXISTS ", 0) != 0 &&
+        ddl.rfind("CREATE OR REPLACE FUNCTION ", 0) != 0)
+      TEST_FAILED("Unexpected statement for a missing index: " + ddl);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void translations()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::return_type ret;
+
+  QueryOptions options;
+  options.SetCountries("fi");
+  options.SetLanguage("fi");
+  options.SetTranslations("sv,en");
+
+  ret = lq.FetchByName(options, "Helsinki");
+  if (ret.empty())
+    TEST_FAILED("Should find Helsinki");
+  if (ret[0].name != "Helsinki")
+    TEST_FAILED("Name of first match should be Helsinki, not " + ret[0].name);
+  if (ret[0].translations.size() != 2)
+    TEST_FAILED("Should get 2 translations, got " +
+                lexical_cast<string>(ret[0].translations.size()));
+
+  const auto sv = ret[0].translations.find("sv");
+  if (sv == ret[0].translations.end())
+    TEST_FAILED("Swedish translation is missing");
+  if (sv->second.name != "Helsingfors")
+    TEST_FAILED("Swedish name should be Helsingfors, not " + sv->second.name);
+
+  const auto en = ret[0].translations.find("en");
+  if (en == ret[0].translations.end())
+    TEST_FAILED("English translation is missing");
+  if (en->second.country != "Finland")
+    TEST_FAILED("English country name should be Finland, not " + en->second.country);
+  if (ret[0].country != "Suomi")
+    TEST_FAILED("Finnish country name should be Suomi, not " + ret[0].country);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void preloaded_name_variants()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  QueryOptions options;
+  options.SetCountries("fi");
+  options.SetLanguage("sv");
+
+  const auto expected = lq.FetchByName(options, "Helsinki");
+  if (expected.empty() || expected[0].name != "Helsingfors")
+    TEST_FAILED("Swedish name of Helsinki should be Helsingfors");
+
+  lq.load_name_variants({"sv"});
+  const auto ret = lq.FetchByName(options, "Helsinki");
+
+  // Do not affect the other tests
+  lq.load_name_variants({});
+
+  if (ret.size() != expected.size())
+    TEST_FAILED("Preloading names should not change the number of results");
+
+  for (std::size_t i = 0; i < ret.size(); i++)
+    if (ret[i].name != expected[i].name)
+      TEST_FAILED("Expected preloaded name " + expected[i].name + ", got " + ret[i].name);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void diacritic_insensitive_search()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::return_type ret;
+
+  for (const auto& ddl : lq.MissingSearchIndexes())
+    if (ddl.find("FUNCTION locus_fold") != string::npos)
+      TEST_FAILED("locus_fold is not installed, see test/sql/search-indexes.sql");
+
+  QueryOptions options;
+  options.SetDiacriticInsensitiveSearch(true);
+
+  ret = lq.FetchByName(options, "Aanekoski");
+  if (ret.empty())
+    TEST_FAILED("Should find Äänekoski with Aanekoski");
+  if (ret[0].name != "Äänekoski")
+    TEST_FAILED("Name of first match should be Äänekoski, not " + ret[0].name);
+
+  ret = lq.FetchByName(options, "JYVAS%");
+  if (ret.empty())
+    TEST_FAILED("Should find Jyväskylä with a prefix search");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void administrative_names()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  // Places outside Finland have no municipality, the area comes from admin1codes
+
+  QueryOptions options;
+  options.SetCountries("de");
+
+  const auto ret = lq.FetchByName(options, "Dresden");
+  if (ret.empty())
+    TEST_FAILED("Should find Dresden");
+  if (ret[0].admin != "Saxony")
+    TEST_FAILED("Administrative area of Dresden should be Saxony, not '" + ret[0].admin + "'");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void fuzzy_search()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+  Query::return_type ret;
+
+  QueryOptions options;
+  options.SetCountries("fi");
+
+  ret = lq.FetchByName(options, "Helsinky");
+  if (!ret.empty())
+    TEST_FAILED("Should not find Helsinky without fuzzy search");
+
+  options.SetFuzzySearch(true);
+  options.SetFuzzyTimeout(2000);
+
+  ret = lq.FetchByName(options, "Helsinky");
+  if (ret.empty())
+    TEST_FAILED("Should find Helsinki with fuzzy search");
+  if (ret[0].name != "Helsinki")
+    TEST_FAILED("Name of first match should be Helsinki, not " + ret[0].name);
+
+  ret = lq.FetchByName(options, "Helsinki");
+  if (ret.empty() || ret[0].name != "Helsinki")
+    TEST_FAILED("Exact matches should not be affected by fuzzy search");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
 void specific_language()
 {
   Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
@@ -505,6 +725,15 @@ void simple_lonlat_search()
   if (ret.back().name != "Kuivasaari")
     TEST_FAILED("Name of second match should be Kuivasaari, not " + ret.back().name);
 
+  for (const auto& loc : ret)
+  {
+    if (!loc.distance || !loc.bearing)
+      TEST_FAILED("Distance and bearing should be available for " + loc.name);
+    if (*loc.bearing < 0 || *loc.bearing >= 360)
+      TEST_FAILED("Bearing of " + loc.name +
+                  " out of range: " + lexical_cast<string>(*loc.bearing));
+  }
+
   TEST_PASSED();
 }
 
@@ -554,6 +783,49 @@ void specific_radius()
 
 // ----------------------------------------------------------------------
 
+void exact_radius_search()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  Query::return_type ret;
+
+  QueryOptions options;
+  options.SetResultLimit(0);
+  options.SetExactRadiusSearch(true);
+  ret = lq.FetchByLonLat(options, 24.97, 60.10, 4);
+
+  if (ret.size() < 10)
+    TEST_FAILED("Should find atleast 10 matches in radius 4km, not " +
+                lexical_cast<string>(ret.size()));
+
+  if (ret[0].name != "Harmaja")
+    TEST_FAILED("Name of first match should be Harmaja, not " + ret[0].name);
+
+  float previous = 0;
+  for (const auto& loc : ret)
+  {
+    if (!loc.distance)
+      TEST_FAILED("Distance should be available for " + loc.name);
+    if (*loc.distance > 4)
+      TEST_FAILED(loc.name + " is outside the radius: " + lexical_cast<string>(*loc.distance));
+    if (*loc.distance < previous)
+      TEST_FAILED("Results should be sorted by distance");
+    previous = *loc.distance;
+  }
+
+  // The result limit is applied after the radius
+
+  options.SetResultLimit(3);
+  auto limited = lq.FetchByLonLat(options, 24.97, 60.10, 4);
+  if (limited.size() != 3)
+    TEST_FAILED("Should find 3 matches since limit is 3");
+  for (std::size_t i = 0; i < limited.size(); i++)
+    if (limited[i].id != ret[i].id)
+      TEST_FAILED("Limited result differs from full result at " + lexical_cast<string>(i));
+
+  TEST_PASSED();
+}
+
 // ----------------------------------------------------------------------
 
 void search_keyword()
@@ -758,10 +1030,18 @@ class tests : public tframe::tests
     TEST(utf8_region_search);
     TEST(search_with_area);
     TEST(specific_countries);
+    TEST(full_country_search);
+    TEST(indexed_name_search);
+    TEST(translations);
+    TEST(preloaded_name_variants);
+    TEST(diacritic_insensitive_search);
+    TEST(administrative_names);
+    TEST(fuzzy_search);
     TEST(specific_features);
     TEST(specific_keywords);
     TEST(specific_language);
     TEST(specific_radius);
+    TEST(exact_radius_search);
     TEST(specific_result_limit);
     TEST(specific_variants);
 
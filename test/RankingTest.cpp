@@ -0,0 +1,146 @@
+#include "Ranking.h"
+#include <regression/tframe.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+namespace RankingTest
+{
+Ranking::Candidate candidate(const string& theName,
+                             unsigned int thePopulation,
+                             unsigned int theCountry = 1,
+                             int thePriority = 0)
+{
+  Ranking::Candidate ret;
+  ret.name = theName;
+  ret.population = thePopulation;
+  ret.country_priority = theCountry;
+  ret.feature_priority = 1;
+  ret.priority = thePriority;
+  return ret;
+}
+
+string names(const vector<Ranking::Candidate>& theCandidates, const vector<size_t>& theOrder)
+{
+  string ret;
+  for (auto i : theOrder)
+  {
+    if (!ret.empty())
+      ret += ',';
+    ret += theCandidates[i].name;
+  }
+  return ret;
+}
+
+// ----------------------------------------------------------------------
+
+void default_order()
+{
+  const vector<Ranking::Candidate> candidates{candidate("Ö", 100),
+                                              candidate("Small", 1000, 1),
+                                              candidate("Other", 2000, 2),
+                                              candidate("Big", 600000, 2),
+                                              candidate("Priority", 10, 2, -1),
+                                              candidate("A", 100),
+                                              candidate("Ä", 100)};
+
+  const string result = names(candidates, Ranking().order(candidates));
+  const string expected = "Priority,Big,Small,A,Ä,Ö,Other";
+  if (result != expected)
+    TEST_FAILED("Expected " + expected + ", got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void scorer()
+{
+  const vector<Ranking::Candidate> candidates{
+      candidate("Helsinki", 600000), candidate("Hel", 10), candidate("Helsinge", 100)};
+
+  // Prefer short names, as an autocomplete might do
+  Ranking ranking([](const Ranking::Candidate& c) { return -static_cast<double>(c.name.size()); });
+
+  const string result = names(candidates, ranking.order(candidates));
+  const string expected = "Hel,Helsinki,Helsinge";
+  if (result != expected)
+    TEST_FAILED("Expected " + expected + ", got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void collation()
+{
+  const vector<Ranking::Candidate> candidates{candidate("Ä", 100), candidate("Z", 100)};
+  const Ranking ranking;
+
+  string result = names(candidates,
+                        ranking.order(candidates, 0, Ranking::collation_locale("utf8_swedish_ci")));
+  if (result != "Z,Ä")
+    TEST_FAILED("Expected Z,Ä in Swedish collation, got " + result);
+
+  result = names(candidates,
+                 ranking.order(candidates, 0, Ranking::collation_locale("utf8_general_ci")));
+  if (result != "Ä,Z")
+    TEST_FAILED("Expected Ä,Z in general collation, got " + result);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void limited_order()
+{
+  vector<Ranking::Candidate> candidates;
+  for (unsigned int i = 0; i < 100; i++)
+    candidates.push_back(candidate("Place " + to_string(i % 7), (i * 7919) % 1000, i % 3));
+
+  const Ranking ranking;
+  const auto full = ranking.order(candidates);
+
+  for (size_t limit : {1, 5, 10, 99, 100, 200})
+  {
+    const auto top = ranking.order(candidates, limit);
+    const auto expected_size = std::min(limit, candidates.size());
+    if (top.size() != expected_size)
+      TEST_FAILED("Expected " + to_string(expected_size) + " candidates, got " +
+                  to_string(top.size()));
+    if (!std::equal(top.begin(), top.end(), full.begin()))
+      TEST_FAILED("Best " + to_string(limit) + " candidates differ from the full order");
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(default_order);
+    TEST(scorer);
+    TEST(collation);
+    TEST(limited_order);
+  }
+};  // class tests
+
+}  // namespace RankingTest
+
+int main(void)
+{
+  cout << endl << "Ranking tester" << endl << "==============" << endl;
+  RankingTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,129 @@
+#include "Reloadable.h"
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <regression/tframe.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+
+namespace ReloadableTest
+{
+// ----------------------------------------------------------------------
+
+void snapshot_survives_reload()
+{
+  Reloadable<vector<int>> data(std::make_shared<const vector<int>>(vector<int>{1, 2, 3}));
+
+  auto old_snapshot = data.snapshot();
+  data.store(std::make_shared<const vector<int>>(vector<int>{4}));
+
+  if (old_snapshot->data->size() != 3)
+    TEST_FAILED("Old generation should still contain 3 elements");
+
+  if (data.get()->size() != 1)
+    TEST_FAILED("New generation should contain 1 element");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void generation_increases()
+{
+  Reloadable<string> data;
+
+  const auto gen0 = data.generation();
+  data.reload([]() { return std::make_shared<const string>("first"); });
+  const auto gen1 = data.generation();
+  data.reload([]() { return std::make_shared<const string>("second"); });
+  const auto gen2 = data.generation();
+
+  if (!(gen0 < gen1 && gen1 < gen2))
+    TEST_FAILED("Generations should increase: " + boost::lexical_cast<string>(gen0) + ", " +
+                boost::lexical_cast<string>(gen1) + ", " + boost::lexical_cast<string>(gen2));
+
+  if (CurrentDataGeneration() < gen2)
+    TEST_FAILED("Global generation should not be older than the latest reload");
+
+  if (*data.get() != "second")
+    TEST_FAILED("Latest reload should be visible, got '" + *data.get() + "'");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void copy_on_write_update()
+{
+  Reloadable<vector<int>> data(std::make_shared<const vector<int>>(vector<int>{1, 2, 3}));
+
+  auto old_data = data.get();
+  const auto old_generation = data.generation();
+  data.update([](vector<int>& values) { values[1] = 20; });
+
+  if ((*old_data)[1] != 2)
+    TEST_FAILED("Update should not modify the previous generation");
+
+  if ((*data.get())[1] != 20 || data.get()->size() != 3)
+    TEST_FAILED("Update should be visible in the new generation");
+
+  if (data.generation() <= old_generation)
+    TEST_FAILED("Update should create a new generation");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+void retry_after_failure()
+{
+  Reloadable<string> data;
+
+  data.invalidate();
+  if (!data.claim_refresh())
+    TEST_FAILED("Refresh should be claimable after invalidate");
+  if (data.claim_refresh())
+    TEST_FAILED("Refresh should be claimable only once");
+
+  // A failed refresh is retried only after the delay
+  data.retry_after(std::chrono::hours(1));
+  if (!data.stale())
+    TEST_FAILED("Data should stay outdated after a failed refresh");
+  if (data.claim_refresh())
+    TEST_FAILED("Refresh should not be claimable before the retry delay");
+
+  data.retry_after(std::chrono::seconds(0));
+  if (!data.claim_refresh())
+    TEST_FAILED("Refresh should be claimable after the retry delay");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+
+// The actual test driver
+class tests : public tframe::tests
+{
+  //! Overridden message separator
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  //! Main test suite
+  void test(void)
+  {
+    TEST(snapshot_survives_reload);
+    TEST(generation_increases);
+    TEST(copy_on_write_update);
+    TEST(retry_after_failure);
+  }
+};  // class tests
+
+}  // namespace ReloadableTest
+
+int main(void)
+{
+  cout << endl << "Reloadable tester" << endl << "=================" << endl;
+  ReloadableTest::tests t;
+  return t.run();
+}
@@ -0,0 +1,94 @@
+// ======================================================================
+/*!
+ * \brief Allocations of the caches of build_locations with and without an arena
+ *
+ * The name variant and country name caches are built for a result set
+ * of Finnish places fetched from the test database, once from the heap
+ * and once from an arena like the one in build_locations. The times
+ * include the statements run by the caches.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "Query.h"
+#include "QueryOptions.h"
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace Benchmark;
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Access to the private caches of Query
+ */
+// ----------------------------------------------------------------------
+
+struct QueryBenchmark
+{
+  static pqxx::result places(Query& theQuery, int theCount)
+  {
+    return theQuery.conn->executeNonTransaction(
+        "SELECT id, name, countries_iso2 AS iso2, timezone FROM geonames"
+        " WHERE countries_iso2='FI' AND timezone IS NOT NULL ORDER BY id LIMIT " +
+        to_string(theCount));
+  }
+
+  static std::size_t caches(Query& theQuery,
+                            const QueryOptions& theOptions,
+                            const pqxx::result& theResult,
+                            pmr::memory_resource* theResource)
+  {
+    const auto names = theQuery.getNameVariants(theOptions, theResult, "%", theResource);
+    const auto countries = theQuery.getCountryNames(theOptions, theResult, theResource);
+    return names.size() + countries.size();
+  }
+};
+}  // namespace Locus
+
+using namespace Locus;
+
+int main()
+{
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  QueryOptions options;
+  options.SetLanguage("sv");
+
+  cout << "Allocations of the name variant and country caches\n"
+       << fixed << setprecision(1) << setw(10) << "rows" << setw(12) << "default" << setw(12)
+       << "arena" << setw(14) << "default ms" << setw(12) << "arena ms" << '\n';
+
+  for (int rows : {10, 100, 1000, 10000})
+  {
+    const auto result = QueryBenchmark::places(lq, rows);
+
+    // Warm up the connection and the caches of the database
+    sink += QueryBenchmark::caches(lq, options, result, pmr::new_delete_resource());
+
+    CountingResource heap;
+    const double heap_time =
+        seconds([&]() { sink += QueryBenchmark::caches(lq, options, result, &heap); });
+
+    // Same initial buffer as in build_locations
+    CountingResource upstream;
+    const double arena_time = seconds(
+        [&]()
+        {
+          std::array<std::byte, 4096> buffer;
+          pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), &upstream);
+          sink += QueryBenchmark::caches(lq, options, result, &arena);
+        });
+
+    cout << setw(10) << result.size() << setw(12) << heap.allocations << setw(12)
+         << upstream.allocations << setw(14) << 1e3 * heap_time << setw(12) << 1e3 * arena_time
+         << '\n';
+  }
+  return 0;
+}
+
+// ======================================================================
@@ -0,0 +1,86 @@
+// ======================================================================
+/*!
+ * \brief Helpers shared by the benchmarks
+ *
+ * The benchmarks are not run by "make test" since the timings depend on
+ * the machine and need an optimized build. Run with "make benchmark".
+ */
+// ======================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+#ifndef DATABASE_HOST
+#define DATABASE_HOST "smartmet-test"
+#endif
+#ifndef DATABASE_USER
+#define DATABASE_USER "fminames_user"
+#endif
+#ifndef DATABASE_PASS
+#define DATABASE_PASS "fminames_pw"
+#endif
+#ifndef DATABASE_PORT
+#define DATABASE_PORT "5444"
+#endif
+#ifndef DATABASE
+#define DATABASE "fminames"
+#endif
+
+namespace Benchmark
+{
+// Prevents the compiler from removing the benchmarked work
+inline volatile std::size_t sink = 0;
+
+// Wall clock time of a call in seconds
+template <typename Function>
+double seconds(Function&& theFunction)
+{
+  const auto start = std::chrono::steady_clock::now();
+  theFunction();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Names long enough not to fit in the small string buffer
+inline std::string place_name(int theId)
+{
+  return "Name of place number " + std::to_string(theId);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Memory resource counting the allocations passed upstream
+ */
+// ----------------------------------------------------------------------
+
+class CountingResource : public std::pmr::memory_resource
+{
+ public:
+  std::size_t allocations = 0;
+  std::size_t bytes = 0;
+
+ private:
+  void* do_allocate(std::size_t theBytes, std::size_t theAlignment) override
+  {
+    ++allocations;
+    bytes += theBytes;
+    return std::pmr::new_delete_resource()->allocate(theBytes, theAlignment);
+  }
+
+  void do_deallocate(void* thePtr, std::size_t theBytes, std::size_t theAlignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(thePtr, theBytes, theAlignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& theOther) const noexcept override
+  {
+    return this == &theOther;
+  }
+};
+
+}  // namespace Benchmark
+
+// ======================================================================
@@ -0,0 +1,67 @@
+// ======================================================================
+/*!
+ * \brief Lookups in the FlatMap caches of build_locations
+ *
+ * Compares lookups by id in a FlatMap with those in a std::map
+ * over tables of the size of typical and large result sets.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "FlatMap.h"
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+using namespace Benchmark;
+
+int main()
+{
+  cout << "Lookups of existing ids, ns per lookup\n"
+       << fixed << setprecision(1) << setw(10) << "size" << setw(12) << "std::map" << setw(12)
+       << "FlatMap" << '\n';
+
+  const std::size_t lookups = 1000000;
+  mt19937 generator(1);
+
+  for (int size : {16, 256, 4096, 65536})
+  {
+    map<int, string> tree;
+    FlatMap<int, pmr::string> flat;
+    for (int i = 0; i < size; i++)
+    {
+      tree.emplace(i * 7, place_name(i));
+      flat.add(i * 7, place_name(i));
+    }
+    flat.sort();
+
+    uniform_int_distribution<int> index(0, size - 1);
+    vector<int> keys(lookups);
+    for (auto& key : keys)
+      key = index(generator) * 7;
+
+    const double tree_time = seconds(
+        [&]()
+        {
+          for (auto key : keys)
+            sink += tree.find(key)->second.size();
+        });
+    const double flat_time = seconds(
+        [&]()
+        {
+          for (auto key : keys)
+            sink += flat.find(key)->second.size();
+        });
+
+    cout << setw(10) << size << setw(12) << 1e9 * tree_time / lookups << setw(12)
+         << 1e9 * flat_time / lookups << '\n';
+  }
+  return 0;
+}
+
+// ======================================================================
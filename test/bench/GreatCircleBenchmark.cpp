@@ -0,0 +1,70 @@
+// ======================================================================
+/*!
+ * \brief Throughput of the great circle distance kernels
+ *
+ * Distances from Helsinki to a million random points, calculated with
+ * each kernel and with one GreatCircleDistance call per point.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "GreatCircle.h"
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Locus;
+using namespace Benchmark;
+
+int main()
+{
+  cout << "Great circle distances, million points per second\n" << fixed << setprecision(1);
+
+  const std::size_t n = 1 << 20;
+  const int repeats = 20;
+
+  mt19937 generator(1);
+  uniform_real_distribution<float> longitude(-180, 180);
+  uniform_real_distribution<float> latitude(-90, 90);
+  vector<float> lons(n);
+  vector<float> lats(n);
+  vector<float> distances(n);
+  for (std::size_t i = 0; i < n; i++)
+  {
+    lons[i] = longitude(generator);
+    lats[i] = latitude(generator);
+  }
+
+  const double single_time = seconds(
+      [&]()
+      {
+        for (std::size_t i = 0; i < n; i++)
+          distances[i] = static_cast<float>(GreatCircleDistance(24.94, 60.17, lons[i], lats[i]));
+        sink += static_cast<std::size_t>(distances[0]);
+      });
+  cout << setw(10) << "Single" << setw(12) << n / single_time / 1e6 << '\n';
+
+  for (auto kernel : {DistanceKernel::Scalar, DistanceKernel::AVX2})
+  {
+    const bool supported = (SelectDistanceKernel(kernel) == kernel);
+    const double time = seconds(
+        [&]()
+        {
+          for (int i = 0; i < repeats; i++)
+          {
+            GreatCircleDistances(
+                24.94f, 60.17f, lons.data(), lats.data(), n, distances.data(), kernel);
+            sink += static_cast<std::size_t>(distances[i]);
+          }
+        });
+
+    cout << setw(10) << (kernel == DistanceKernel::Scalar ? "Scalar" : "AVX2") << setw(12)
+         << repeats * n / time / 1e6 << (supported ? "" : "  (not supported, scalar used)")
+         << '\n';
+  }
+  return 0;
+}
+
+// ======================================================================
@@ -0,0 +1,117 @@
+// ======================================================================
+/*!
+ * \brief Heap allocations and time of language code lookups
+ *
+ * The codes of a language are precomputed by ISO639, hence looking
+ * them up and getting the SQL condition of a known language should not
+ * allocate at all. Allocations are counted by replacing the global
+ * operator new of this program.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "ISO639.h"
+#include "Query.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Benchmark;
+
+namespace
+{
+std::size_t allocations = 0;
+}
+
+void* operator new(std::size_t theSize)
+{
+  ++allocations;
+  if (void* ptr = std::malloc(theSize ? theSize : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* thePtr) noexcept
+{
+  std::free(thePtr);
+}
+
+void operator delete(void* thePtr, std::size_t /* theSize */) noexcept
+{
+  std::free(thePtr);
+}
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Access to the language conditions of Query
+ */
+// ----------------------------------------------------------------------
+
+struct QueryBenchmark
+{
+  static const std::string& condition(const Query& theQuery,
+                                      const std::string& theLanguage,
+                                      std::string& theUnknown)
+  {
+    return theQuery.getLanguageCodeCondition(theLanguage, theUnknown);
+  }
+};
+}  // namespace Locus
+
+using namespace Locus;
+
+namespace
+{
+// Allocations per call and nanoseconds per call of a lookup
+template <typename Function>
+void measure(const char* theName, Function&& theFunction)
+{
+  const std::size_t calls = 1000000;
+  const std::size_t before = allocations;
+  const double time = seconds(
+      [&]()
+      {
+        for (std::size_t i = 0; i < calls; i++)
+          sink += theFunction(i);
+      });
+  cout << setw(28) << theName << setw(14) << double(allocations - before) / calls << setw(12)
+       << 1e9 * time / calls << '\n';
+}
+}  // namespace
+
+int main()
+{
+  const vector<string> languages{"fi", "sv", "en", "fin", "swe", "eng"};
+
+  ISO639 table;
+  table.add(ISO639::Entry{string("fi"), string("fin"), "fin", "Finnish"});
+  table.add(ISO639::Entry{string("sv"), string("swe"), "swe", "Swedish"});
+  table.add(ISO639::Entry{string("en"), string("eng"), "eng", "English"});
+
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  cout << "Language code lookups\n"
+       << fixed << setprecision(2) << setw(28) << "lookup" << setw(14) << "allocations"
+       << setw(12) << "ns" << '\n';
+
+  const auto language = [&](std::size_t i) -> const string&
+  { return languages[i % languages.size()]; };
+
+  measure("ISO639::find_codes",
+          [&](std::size_t i) { return table.find_codes(language(i)) != nullptr; });
+
+  std::string unknown;
+  measure("getLanguageCodeCondition",
+          [&](std::size_t i)
+          { return QueryBenchmark::condition(lq, language(i), unknown).size(); });
+
+  return 0;
+}
+
+// ======================================================================
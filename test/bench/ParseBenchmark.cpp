@@ -0,0 +1,116 @@
+// ======================================================================
+/*!
+ * \brief Parsing the numeric columns of a 100k row location result
+ *
+ * Compares the conversions of build_locations before and after the
+ * column numbers were looked up once per result and integers were
+ * parsed with std::from_chars. Coordinates are parsed with as<float>()
+ * in both cases, so only the integer columns differ in the conversion.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include <boost/lexical_cast.hpp>
+#include <macgyver/PostgreSQLConnection.h>
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+#include <type_traits>
+
+using namespace std;
+using namespace Benchmark;
+
+namespace
+{
+// The same as parse_number in Query.cpp
+template <typename T>
+T parse_number(const pqxx::field& theField)
+{
+  if constexpr (std::is_integral_v<T>)
+  {
+    T value{};
+    const char* begin = theField.c_str();
+    const char* end = begin + theField.size();
+    const auto result = std::from_chars(begin, end, value);
+    if (result.ec == std::errc() && result.ptr == end)
+      return value;
+  }
+  return theField.as<T>();
+}
+
+// Sum of the parsed values so that the conversions are not optimized away
+double by_name(const pqxx::result& theResult)
+{
+  double sum = 0;
+  for (const auto& row : theResult)
+  {
+    sum += row["id"].as<int>() + row["population"].as<int>() + row["elevation"].as<int>() +
+           row["dem"].as<int>();
+    sum += row["lon"].as<float>() + row["lat"].as<float>();
+  }
+  return sum;
+}
+
+double by_column_as(const pqxx::result& theResult)
+{
+  double sum = 0;
+  for (const auto& row : theResult)
+  {
+    sum += row[0].as<int>() + row[1].as<int>() + row[2].as<int>() + row[3].as<int>();
+    sum += row[4].as<float>() + row[5].as<float>();
+  }
+  return sum;
+}
+
+double by_column_from_chars(const pqxx::result& theResult)
+{
+  double sum = 0;
+  for (const auto& row : theResult)
+  {
+    sum += parse_number<int>(row[0]) + parse_number<int>(row[1]) + parse_number<int>(row[2]) +
+           parse_number<int>(row[3]);
+    sum += parse_number<float>(row[4]) + parse_number<float>(row[5]);
+  }
+  return sum;
+}
+}  // namespace
+
+int main()
+{
+  Fmi::Database::PostgreSQLConnectionOptions opt;
+  opt.host = DATABASE_HOST;
+  opt.port = boost::lexical_cast<unsigned int>(DATABASE_PORT);
+  opt.username = DATABASE_USER;
+  opt.password = DATABASE_PASS;
+  opt.database = DATABASE;
+  opt.encoding = "UTF8";
+  Fmi::Database::PostgreSQLConnection conn;
+  conn.open(opt);
+
+  // Values of the same magnitude as in geonames
+  const auto result = conn.executeNonTransaction(
+      "SELECT i AS id, (i*7919)%2000000 AS population, (i*31)%1500 AS elevation,"
+      " (i*17)%1500 AS dem, -180+mod(i*0.0036,360) AS lon, -90+mod(i*0.0018,180) AS lat"
+      " FROM generate_series(1,100000) AS i");
+
+  cout << "Parsing " << result.size() << " rows, ms per result\n" << fixed << setprecision(2);
+
+  const int repeats = 10;
+  const auto measure = [&](const char* theName, double (*theParser)(const pqxx::result&))
+  {
+    const double time = seconds(
+        [&]()
+        {
+          for (int i = 0; i < repeats; i++)
+            sink += static_cast<std::size_t>(theParser(result));
+        });
+    cout << setw(28) << theName << setw(10) << 1e3 * time / repeats << '\n';
+  };
+
+  measure("as<T>() by column name", by_name);
+  measure("as<T>() by column number", by_column_as);
+  measure("from_chars by column number", by_column_from_chars);
+  return 0;
+}
+
+// ======================================================================
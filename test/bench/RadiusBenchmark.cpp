@@ -0,0 +1,64 @@
+// ======================================================================
+/*!
+ * \brief Radius searches in a dense area
+ *
+ * Times FetchByLonLat around central Helsinki with the exact radius
+ * search (eFetchByRadius) and with the default nearest neighbour
+ * search, both without a result limit so that every place inside the
+ * radius is returned.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "Query.h"
+#include "QueryOptions.h"
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace Locus;
+using namespace Benchmark;
+
+int main()
+{
+  const float lon = 24.94;
+  const float lat = 60.17;
+  const int repeats = 20;
+
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  cout << "Radius searches around Helsinki, ms per search\n"
+       << fixed << setprecision(1) << setw(10) << "radius km" << setw(10) << "places" << setw(12)
+       << "default" << setw(10) << "places" << setw(12) << "exact" << '\n';
+
+  for (float radius : {1.0f, 5.0f, 20.0f, 50.0f})
+  {
+    QueryOptions options;
+    options.SetResultLimit(0);
+
+    const std::size_t default_count = lq.FetchByLonLat(options, lon, lat, radius).size();
+    const double default_time = seconds(
+        [&]()
+        {
+          for (int i = 0; i < repeats; i++)
+            sink += lq.FetchByLonLat(options, lon, lat, radius).size();
+        });
+
+    options.SetExactRadiusSearch(true);
+
+    const std::size_t exact_count = lq.FetchByLonLat(options, lon, lat, radius).size();
+    const double exact_time = seconds(
+        [&]()
+        {
+          for (int i = 0; i < repeats; i++)
+            sink += lq.FetchByLonLat(options, lon, lat, radius).size();
+        });
+
+    cout << setw(10) << radius << setw(10) << default_count << setw(12)
+         << 1e3 * default_time / repeats << setw(10) << exact_count << setw(12)
+         << 1e3 * exact_time / repeats << '\n';
+  }
+  return 0;
+}
+
+// ======================================================================
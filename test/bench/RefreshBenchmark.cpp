@@ -0,0 +1,130 @@
+// ======================================================================
+/*!
+ * \brief Incremental refresh of the preloaded name variants against a full reload
+ *
+ * The changes are reported for places in alternate_geonames as a
+ * ChangeTracker would report them, and applied like Query::PollChanges
+ * does. The peak memory is the growth of the peak resident set size of
+ * the process, hence the incremental refreshes are measured before the
+ * full reload, which holds two generations of the table at once.
+ */
+// ======================================================================
+
+#include "Benchmark.h"
+#include "ChangeSource.h"
+#include "Query.h"
+#include <sys/resource.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Benchmark;
+
+namespace Locus
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Access to the name variant refresh of Query
+ */
+// ----------------------------------------------------------------------
+
+struct QueryBenchmark
+{
+  // Places with names in the preloaded languages
+  static vector<string> places(Query& theQuery, int theCount)
+  {
+    const auto res = theQuery.conn->executeNonTransaction(
+        "SELECT DISTINCT geonames_id FROM alternate_geonames WHERE language IN ('fi','sv','en')"
+        " ORDER BY geonames_id LIMIT " +
+        to_string(theCount));
+    vector<string> ids;
+    for (const auto& row : res)
+      ids.push_back(row[0].as<string>());
+    return ids;
+  }
+
+  // The same as Query::PollChanges after the changes have been reported
+  static void refresh(Query& theQuery)
+  {
+    if (Query::name_variant_table().claim_refresh())
+      theQuery.ApplyNameVariantChanges();
+  }
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Reports the given changes to the subscribers
+ */
+// ----------------------------------------------------------------------
+
+class BenchmarkChanges : public ChangeSource
+{
+ public:
+  void report(const vector<string>& theIds)
+  {
+    for (const auto& id : theIds)
+      dispatch(Change{"alternate_geonames", id});
+  }
+};
+}  // namespace Locus
+
+using namespace Locus;
+
+namespace
+{
+std::size_t peak_rss_kb()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+}  // namespace
+
+int main()
+{
+  const vector<string> languages{"fi", "sv", "en"};
+
+  Query lq(DATABASE_HOST, DATABASE_USER, DATABASE_PASS, DATABASE, DATABASE_PORT);
+
+  BenchmarkChanges changes;
+  Query::InvalidateOnChanges(changes);
+
+  cout << "Refresh of the preferred names of fi, sv and en\n"
+       << fixed << setprecision(1) << setw(16) << "refresh" << setw(12) << "ms" << setw(18)
+       << "peak growth kB" << '\n';
+
+  const auto report = [](const string& theName, double theTime, std::size_t theRss)
+  {
+    cout << setw(16) << theName << setw(12) << 1e3 * theTime << setw(18)
+         << (peak_rss_kb() - theRss) << '\n';
+  };
+
+  std::size_t rss = peak_rss_kb();
+  double time = seconds([&]() { lq.load_name_variants(languages); });
+  report("initial load", time, rss);
+
+  // Fewer changes than max_name_variant_changes, more would be merged by a full reload
+  for (int count : {10, 100, 1000, 5000})
+  {
+    const auto ids = QueryBenchmark::places(lq, count);
+    rss = peak_rss_kb();
+    time = seconds(
+        [&]()
+        {
+          changes.report(ids);
+          QueryBenchmark::refresh(lq);
+        });
+    report(to_string(ids.size()) + " places", time, rss);
+  }
+
+  rss = peak_rss_kb();
+  time = seconds([&]() { lq.load_name_variants(languages); });
+  report("full reload", time, rss);
+
+  return 0;
+}
+
+// ======================================================================
@@ -0,0 +1,28 @@
+-- Functions and indexes used by the indexed and diacritic insensitive name searches,
+-- see Query::MissingSearchIndexes. Applied to the local test database
+-- by "make start-geonames-db".
+
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
+
+CREATE INDEX IF NOT EXISTS geonames_lower_name_idx
+    ON geonames (LOWER(name) text_pattern_ops);
+CREATE INDEX IF NOT EXISTS alternate_geonames_lower_name_idx
+    ON alternate_geonames (LOWER(name) text_pattern_ops);
+
+CREATE INDEX IF NOT EXISTS geonames_name_trgm_idx
+    ON geonames USING gin (name gin_trgm_ops);
+CREATE INDEX IF NOT EXISTS alternate_geonames_name_trgm_idx
+    ON alternate_geonames USING gin (name gin_trgm_ops);
+
+-- Search keys of diacritic insensitive searches, the same as locus_fold_ddl in Query.cpp
+
+CREATE EXTENSION IF NOT EXISTS unaccent;
+
+CREATE OR REPLACE FUNCTION locus_fold(text) RETURNS text AS
+    $$ SELECT lower(public.unaccent('public.unaccent'::regdictionary, $1)) $$
+    LANGUAGE sql IMMUTABLE PARALLEL SAFE STRICT;
+
+CREATE INDEX IF NOT EXISTS geonames_fold_name_idx
+    ON geonames (locus_fold(name) text_pattern_ops);
+CREATE INDEX IF NOT EXISTS alternate_geonames_fold_name_idx
+    ON alternate_geonames (locus_fold(name) text_pattern_ops);